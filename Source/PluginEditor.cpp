@@ -219,8 +219,7 @@ juce::String RotarySliderWithLabels::getDisplayString() const
 
 ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : 
 audioProcessor(p),
-leftPathProducer(audioProcessor.leftChannelFifo),
-rightPathProducer(audioProcessor.rightChannelFifo)
+analyzerClient(p)
 {
     const auto& params = audioProcessor.getParameters();
     for (auto param : params )
@@ -230,12 +229,16 @@ rightPathProducer(audioProcessor.rightChannelFifo)
     
     updateChain();
     
+    analyzerWorker->addClient(&analyzerClient);
+    
     // Starting with a 60 Hz refresher
     startTimerHz(60);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+    analyzerWorker->removeClient(&analyzerClient);
+    
     const auto& params = audioProcessor.getParameters();
     for (auto param : params )
     {
@@ -248,44 +251,61 @@ void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float new
     parametersChanged.set(true);
 }
 
-void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+bool PathProducer::process(const float* leftSamples, const float* rightSamples, int numSamples, juce::Rectangle<float> fftBounds, double sampleRate)
 {
-    juce::AudioBuffer<float> tempIncomingBuffer;
-    
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
+    if (numSamples > 0)
     {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer))
-        {
-            // shift over data
-            auto size = tempIncomingBuffer.getNumSamples();
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                                              monoBuffer.getReadPointer(0, size),
-                                              monoBuffer.getNumSamples() - size);
-            
-            // copy new data to the end
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                                              tempIncomingBuffer.getReadPointer(0, 0),
-                                              size);
-            
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
-        }
+        // Nothing older than the newest history size samples can reach the FFT
+        auto size = (int)leftHistory.size();
+        auto newest = juce::jmin(numSamples, size);
+        leftSamples += numSamples - newest;
+        rightSamples += numSamples - newest;
+        
+        // Into the histories at the write index, wrapping round at most once
+        auto first = juce::jmin(newest, size - historyWriteIndex);
+        juce::FloatVectorOperations::copy(leftHistory.data() + historyWriteIndex, leftSamples, first);
+        juce::FloatVectorOperations::copy(leftHistory.data(), leftSamples + first, newest - first);
+        juce::FloatVectorOperations::copy(rightHistory.data() + historyWriteIndex, rightSamples, first);
+        juce::FloatVectorOperations::copy(rightHistory.data(), rightSamples + first, newest - first);
+        historyWriteIndex = (historyWriteIndex + newest) % size;
+        
+        samplesSinceLastFFT += numSamples;
+        samplesSinceLastFrame += numSamples;
     }
-    // if there are FFT data buffers to pull
-    //   if we can pull a buffer
-    //      generate a path
-    
-//    const auto fftBounds = getAnalysisArea().toFloat();
-    const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
-    
-    
-    const auto binWidth = sampleRate / (double) fftSize; //audioProcessor.getSampleRate() / (double)fftSize;
     
-    while ( leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0 )
+    // However many hops went by, one FFT of the newest frame covers them
+    if (samplesSinceLastFFT >= hopSize)
     {
-        std::vector<float> fftData;
-        if (leftChannelFFTDataGenerator.getFFTData(fftData))
+        samplesSinceLastFFT %= hopSize;
+        
+        // The averaging and peak decay go by the time between frames, so the hop doesn't change them
+        auto frameSeconds = (double)samplesSinceLastFrame / juce::jmax(1.0, sampleRate);
+        samplesSinceLastFrame = 0;
+        
+        auto averagingCoefficient = averagingTime > 0.0 ? (float)std::exp(-frameSeconds / averagingTime) : 0.f;
+        // With peak hold off the peaks just follow the frame, so turning it on starts from the
+        // live spectrum rather than from maxima held since the analyzer was opened
+        auto peakDecay = peakDecayRate > 0.0 ? (float)(peakDecayRate * frameSeconds) : std::numeric_limits<float>::infinity();
+        
+        fftDataGenerator.produceFFTDataForRendering(leftHistory.data(), rightHistory.data(), (int)leftHistory.size(), historyWriteIndex, -48.f,
+                                                    averagingCoefficient, peakDecay);
+        
+        // generate a path for each channel straight from the generator's spectra
+        const auto fftSize = fftDataGenerator.getFFTSize();
+        const auto binWidth = sampleRate / (double) fftSize;
+        
+        leftPathGenerator.generatePath(fftDataGenerator.getSpectrum(0), fftBounds, fftSize, binWidth, -48.f);
+        rightPathGenerator.generatePath(fftDataGenerator.getSpectrum(1), fftBounds, fftSize, binWidth, -48.f);
+        
+        if (peakDecayRate > 0.0)
         {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
+            leftPeakPathGenerator.generatePath(fftDataGenerator.getPeaks(0), fftBounds, fftSize, binWidth, -48.f);
+            rightPeakPathGenerator.generatePath(fftDataGenerator.getPeaks(1), fftBounds, fftSize, binWidth, -48.f);
+        }
+        else
+        {
+            leftPeakPath.clear();
+            rightPeakPath.clear();
         }
     }
     
@@ -295,115 +315,241 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
             display most recent path
      */
     
-    while (pathProducer.getNumPathsAvailable() )
+    auto pathChanged = false;
+    
+    while (leftPathGenerator.getNumPathsAvailable() )
+    {
+        pathChanged = leftPathGenerator.getPath(leftChannelFFTPath) || pathChanged;
+    }
+    
+    while (rightPathGenerator.getNumPathsAvailable() )
+    {
+        pathChanged = rightPathGenerator.getPath(rightChannelFFTPath) || pathChanged;
+    }
+    
+    while (leftPeakPathGenerator.getNumPathsAvailable() )
+    {
+        leftPeakPathGenerator.getPath(leftPeakPath);
+    }
+    
+    while (rightPeakPathGenerator.getNumPathsAvailable() )
+    {
+        rightPeakPathGenerator.getPath(rightPeakPath);
+    }
+    
+    return pathChanged;
+}
+
+void PathProducer::changeOrder(FFTOrder newOrder)
+{
+    if (newOrder != fftDataGenerator.getOrder() && fftDataGenerator.changeOrder(newOrder))
+    {
+        // The history already holds a full frame for the new size: analyse it on the next call
+        hopSize = juce::jmin(hopSize, getFFTSize());
+        samplesSinceLastFFT = hopSize;
+    }
+}
+
+void PathProducer::reset()
+{
+    std::fill(leftHistory.begin(), leftHistory.end(), 0.f);
+    std::fill(rightHistory.begin(), rightHistory.end(), 0.f);
+    historyWriteIndex = 0;
+    samplesSinceLastFFT = 0;
+    samplesSinceLastFrame = 0;
+}
+
+FFTOrder PathProducer::getOrder(int resolutionIndex, double sampleRate)
+{
+    if (resolutionIndex > 0)
+        return (FFTOrder)juce::jlimit(minFFTOrder, maxFFTOrder, minFFTOrder + resolutionIndex - 1);
+    
+    // 2048 points at 44.1/48 kHz, doubled each time the rate doubles
+    if (sampleRate <= 50000.0)
+        return order2048;
+    
+    return sampleRate <= 100000.0 ? order4096 : order8192;
+}
+
+double PathProducer::getAveragingTime(int averagingIndex)
+{
+    static constexpr std::array<double, 4> times { 0.0, 0.1, 0.3, 1.0 };
+    return times[(size_t)juce::jlimit(0, (int)times.size() - 1, averagingIndex)];
+}
+
+double PathProducer::getPeakDecayRate(int peakHoldIndex)
+{
+    static constexpr std::array<double, 3> rates { 0.0, 3.0, 12.0 };
+    return rates[(size_t)juce::jlimit(0, (int)rates.size() - 1, peakHoldIndex)];
+}
+
+int PathProducer::getSmoothingFraction(int smoothingIndex)
+{
+    static constexpr std::array<int, 4> fractions { 0, 3, 6, 12 };
+    return fractions[(size_t)juce::jlimit(0, (int)fractions.size() - 1, smoothingIndex)];
+}
+
+void AnalyzerClient::setFFTOrder(FFTOrder order)
+{
+    pathProducer.prepareOrder(order);
+    fftOrder = order;
+}
+
+void AnalyzerClient::setDisplayArea(juce::Rectangle<float> fftBounds, double sampleRate)
+{
+    const juce::SpinLock::ScopedLockType lock (displayAreaLock);
+    displayBounds = fftBounds;
+    displaySampleRate = sampleRate;
+}
+
+void AnalyzerClient::analyse()
+{
+    if (! enabled)
+        return;
+    
+    juce::Rectangle<float> fftBounds;
+    double sampleRate;
+    
+    {
+        const juce::SpinLock::ScopedLockType lock (displayAreaLock);
+        fftBounds = displayBounds;
+        sampleRate = displaySampleRate;
+    }
+    
+    auto& tap = audioProcessor.analyzerTap;
+    
+    if (needsResync.exchange(false))
+    {
+        tap.skipToLatest(0);
+        pathProducer.reset();
+    }
+    
+    pathProducer.changeOrder((FFTOrder)fftOrder.load());
+    
+    // Only the newest frame can reach the display. If this pass is late, the rest would only make
+    // the picture lag behind the audio, so it's dropped rather than worked through
+    tap.skipToLatest(pathProducer.getFFTSize());
+    auto numSamples = tap.pull(leftCapture.data(), rightCapture.data(), pathProducer.getFFTSize());
+    
+    auto overlapIndex = (int)audioProcessor.parameterHandles.get(Param_AnalyzerOverlap);
+    pathProducer.setHopSize(PathProducer::getHopSize(pathProducer.getFFTSize(), overlapIndex));
+    pathProducer.setAveragingTime(PathProducer::getAveragingTime((int)audioProcessor.parameterHandles.get(Param_AnalyzerAveraging)));
+    pathProducer.setPeakDecayRate(PathProducer::getPeakDecayRate((int)audioProcessor.parameterHandles.get(Param_AnalyzerPeakHold)));
+    pathProducer.setSmoothing(PathProducer::getSmoothingFraction((int)audioProcessor.parameterHandles.get(Param_AnalyzerSmoothing)));
+    
+    if (pathProducer.process(leftCapture.data(), rightCapture.data(), numSamples, fftBounds, sampleRate))
+    {
+        auto& frame = paths.getWriteBuffer();
+        frame.left = pathProducer.getLeftPath();
+        frame.right = pathProducer.getRightPath();
+        frame.leftPeak = pathProducer.getLeftPeakPath();
+        frame.rightPeak = pathProducer.getRightPeakPath();
+        paths.publish();
+    }
+}
+
+AnalyzerWorker::AnalyzerWorker() : juce::Thread("SimpleEQ Analyzer")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+AnalyzerWorker::~AnalyzerWorker()
+{
+    stopThread(1000);
+}
+
+void AnalyzerWorker::addClient(AnalyzerClient* client)
+{
+    const juce::ScopedLock lock (clientLock);
+    clients.addIfNotAlreadyThere(client);
+}
+
+void AnalyzerWorker::removeClient(AnalyzerClient* client)
+{
+    const juce::ScopedLock lock (clientLock);
+    clients.removeFirstMatchingValue(client);
+}
+
+void AnalyzerWorker::run()
+{
+    while (! threadShouldExit())
     {
-        pathProducer.getPath(leftChannelFFTPath);
+        // The lock is taken for one client at a time, so removing a client waits for at most
+        // that client's analysis. A client added or removed mid-pass may be missed for one frame
+        for (int i = 0; ! threadShouldExit(); ++i)
+        {
+            const juce::ScopedLock lock (clientLock);
+            
+            if (i >= clients.size())
+                break;
+            
+            clients.getUnchecked(i)->analyse();
+        }
+        
+        // One pass per display frame
+        wait(1000 / 60);
     }
 }
 
 void ResponseCurveComponent::timerCallback()
 {
+    // The worker does the analysis; all that's left here is picking up its latest paths
     if (shouldShowFFTAnalysis)
     {
-        auto fftBounds = getAnalysisArea().toFloat();
         auto sampleRate = audioProcessor.getSampleRate();
+        auto resolutionIndex = (int)audioProcessor.parameterHandles.get(Param_AnalyzerResolution);
+        
+        analyzerClient.setDisplayArea(getAnalysisArea().toFloat(), sampleRate);
+        analyzerClient.setFFTOrder(PathProducer::getOrder(resolutionIndex, sampleRate));
         
-        leftPathProducer.process(fftBounds, sampleRate);
-        rightPathProducer.process(fftBounds, sampleRate);
+        if (analyzerClient.paths.acquire())
+            needsRepaint = true;
     }
     
     // Def: bool compareAndSetBool (Type newValue, Type valueToCompare) noexcept
-    if (parametersChanged.compareAndSetBool(false, true))
+    // A new sample rate moves every cutoff too
+    if (parametersChanged.compareAndSetBool(false, true) || audioProcessor.getSampleRate() != chainSampleRate)
     {
         updateChain();
-        
-        // Signal a repaint
-        // repaint();
+        needsRepaint = true;
     }
     
-    repaint();
+    // Nothing moved and no new analyzer frame: the last paint still stands
+    if (needsRepaint)
+    {
+        needsRepaint = false;
+        repaint();
+    }
 }
 
 void ResponseCurveComponent::updateChain()
 {
     // Update the monoChain
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
-    
-    monoChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    monoChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    auto chainSettings = getChainSettings(audioProcessor.parameterHandles);
     
     auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    monoChain.setPeak(peakCoefficients, isBandIdentity(chainSettings, ChainPositions::Peak));
     
     auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
     auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
     
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+    // Bands the processor leaves out are left out of the curve too
+    monoChain.setLowCut(lowCutCoefficients, chainSettings.lowCutSlope, isBandIdentity(chainSettings, ChainPositions::LowCut));
+    monoChain.setHighCut(highCutCoefficients, chainSettings.highCutSlope, isBandIdentity(chainSettings, ChainPositions::HighCut));
+    
+    chainSampleRate = audioProcessor.getSampleRate();
+    updateResponseCurve();
 }
 
-// Paint functuin for Response Curve
-void ResponseCurveComponent::paint (juce::Graphics& g)
+void ResponseCurveComponent::updateResponseCurve()
 {
-    g.fillAll (juce::Colours::black);
-    g.drawImage(background, getLocalBounds().toFloat());
-    
     auto responseArea = getAnalysisArea();
-    // auto responseArea = getRenderArea();
-    // auto responseArea = getLocalBounds();
-    // auto responseArea = bounds.removeFromTop(bounds.getHeight() * 0.33);
     auto w = responseArea.getWidth();
-    auto& lowcut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highcut = monoChain.get<ChainPositions::HighCut>();
     
-    auto sampleRate = audioProcessor.getSampleRate();
+    responseCurve.clear();
     
-    // Computing 1 magnitude per pixel
-    std::vector<double> mags;
-    mags.resize(w);
-    
-    // Need to iterate through each pixel and compute magnitude at that frequency
-    // Magnitude is expressed in Gain units, which are multiplicative, so we start at 1
-    for (int i = 0; i < w; ++i)
-    {
-        double mag = 1.f;
-        // Need to call magnitude function for particular pixel mapped from pixel space to freq space
-        // helper function mapToLog10 maps the normalized pixel number to its freq within human hearing range
-        auto freq = juce::mapToLog10((double(i)) / double(w), 20.0, 20000.0);
-        
-        if (!monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        
-        if ( !monoChain.isBypassed<ChainPositions::LowCut>() )
-        {
-            if (!lowcut.isBypassed<0>())
-                mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<1>())
-                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<2>())
-                mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<3>())
-                mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-
-        if ( !monoChain.isBypassed<ChainPositions::HighCut>() )
-        {
-            if (!highcut.isBypassed<0>())
-                mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<1>())
-                mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<2>())
-                mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<3>())
-                mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        
-        mags[i] = juce::Decibels::gainToDecibels(mag);
-    }
-    
-    juce::Path responseCurve;
+    if (w <= 0)
+        return;
     
     // Mapping decibel values to response area with helper lambda
     const double outputMin = responseArea.getBottom();
@@ -414,27 +560,64 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
         return juce::jmap(input, -24.0, 24.0, outputMin, outputMax);
     };
     
-    // Now we can start new subpath with first magnitude
-    responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
-    
-    for (size_t i = 1; i < mags.size(); ++i)
+    // Computing 1 magnitude per pixel
+    // Need to iterate through each pixel and compute magnitude at that frequency
+    for (int i = 0; i < w; ++i)
     {
-        responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
+        // Need to call magnitude function for particular pixel mapped from pixel space to freq space
+        // helper function mapToLog10 maps the normalized pixel number to its freq within human hearing range
+        auto freq = juce::mapToLog10((double(i)) / double(w), 20.0, 20000.0);
+        
+        // The chain multiplies together the magnitudes of every section that isn't bypassed
+        double mag = monoChain.getMagnitudeForFrequency(freq, chainSampleRate);
+        auto y = map(juce::Decibels::gainToDecibels(mag));
+        
+        if (i == 0)
+            responseCurve.startNewSubPath(responseArea.getX(), y);
+        else
+            responseCurve.lineTo(responseArea.getX() + i, y);
     }
+}
+
+// Paint functuin for Response Curve
+void ResponseCurveComponent::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black);
+    g.drawImage(background, getLocalBounds().toFloat());
+    
+    auto responseArea = getAnalysisArea();
+    // auto responseArea = getRenderArea();
+    // auto responseArea = getLocalBounds();
+    // auto responseArea = bounds.removeFromTop(bounds.getHeight() * 0.33);
     
     if (shouldShowFFTAnalysis)
     {
-        auto leftChannelFFTPath = leftPathProducer.getPath();
+        const auto& analyzerPaths = analyzerClient.paths.getReadBuffer();
+        
+        auto leftChannelFFTPath = analyzerPaths.left;
         leftChannelFFTPath.applyTransform(juce::AffineTransform().translation(responseArea.getX(), responseArea.getY()));
         
         g.setColour(juce::Colours::skyblue);
         g.strokePath(leftChannelFFTPath, juce::PathStrokeType(1.f));
         
-        auto rightChannelFFTPath = rightPathProducer.getPath();
+        auto rightChannelFFTPath = analyzerPaths.right;
         rightChannelFFTPath.applyTransform(juce::AffineTransform().translation(responseArea.getX(), responseArea.getY()));
         
         g.setColour(juce::Colours::blue);
         g.strokePath(rightChannelFFTPath, juce::PathStrokeType(1.f));
+        
+        // Held peaks, fainter than the live spectrum
+        auto leftPeakPath = analyzerPaths.leftPeak;
+        leftPeakPath.applyTransform(juce::AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+        
+        g.setColour(juce::Colours::skyblue.withAlpha(0.4f));
+        g.strokePath(leftPeakPath, juce::PathStrokeType(1.f));
+        
+        auto rightPeakPath = analyzerPaths.rightPeak;
+        rightPeakPath.applyTransform(juce::AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+        
+        g.setColour(juce::Colours::blue.withAlpha(0.4f));
+        g.strokePath(rightPeakPath, juce::PathStrokeType(1.f));
     }
     
 //    auto leftChannelFFTPath = leftPathProducer.getPath();
@@ -453,6 +636,7 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     g.setColour(juce::Colours::orange);
     g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
     
+    // The curve is only rebuilt by updateChain() and resized(), so this is all a repaint costs it
     g.setColour(juce::Colours::white);
     g.strokePath(responseCurve, juce::PathStrokeType(2.f));
     
@@ -460,6 +644,8 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
 
 void ResponseCurveComponent::resized()
 {
+    updateResponseCurve();
+    
     background = juce::Image(juce::Image::PixelFormat::RGB, getWidth(), getHeight(), true);
     juce::Graphics g(background);
     
@@ -587,6 +773,68 @@ juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
     return bounds;
 }
 
+//==============================================================================
+LoadMeterComponent::LoadMeterComponent(LoadMeter& meter) : loadMeter(meter)
+{
+    setMouseCursor(juce::MouseCursor::PointingHandCursor);
+    startTimerHz(10);
+}
+
+void LoadMeterComponent::timerCallback()
+{
+    // Worst block since the last tick, or a slow fall from what's shown
+    auto load = juce::jmax(loadMeter.takePeakLoad(), displayedLoad * 0.85f);
+    
+    if (std::abs(load - displayedLoad) > 0.001f)
+    {
+        displayedLoad = load;
+        repaint();
+    }
+}
+
+void LoadMeterComponent::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+    
+    g.setColour(juce::Colours::darkgrey);
+    g.fillRoundedRectangle(bounds, 3.f);
+    
+    // Green while there's plenty of headroom, orange past half the budget, red at 90%
+    auto colour = displayedLoad < 0.5f ? juce::Colour(0u, 172u, 1u)
+                : displayedLoad < 0.9f ? juce::Colours::orange
+                                       : juce::Colours::red;
+    
+    g.setColour(colour);
+    g.fillRoundedRectangle(bounds.withWidth(bounds.getWidth() * juce::jlimit(0.f, 1.f, displayedLoad)), 3.f);
+    
+    g.setColour(juce::Colours::white);
+    g.setFont(bounds.getHeight() * 0.7f);
+    g.drawFittedText("CPU " + juce::String(juce::roundToInt(100.f * displayedLoad)) + "%",
+                     getLocalBounds(), juce::Justification::centred, 1);
+}
+
+void LoadMeterComponent::mouseUp(const juce::MouseEvent& e)
+{
+    juce::ignoreUnused(e);
+    
+    // Taken now, so the report matches the moment of the click rather than when the dialog closes
+    auto snapshot = loadMeter.getSnapshot();
+    
+    auto defaultFile = juce::File::getSpecialLocation(juce::File::userDesktopDirectory)
+                           .getNonexistentChildFile("simpleEQ load", ".txt");
+    
+    fileChooser = std::make_unique<juce::FileChooser>("Save a load report", defaultFile, "*.txt");
+    fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                              | juce::FileBrowserComponent::warnAboutOverwriting,
+                             [snapshot](const juce::FileChooser& chooser)
+                             {
+                                 auto file = chooser.getResult();
+                                 
+                                 if (file != juce::File())
+                                     snapshot.writeToFile(file);
+                             });
+}
+
 //==============================================================================
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
@@ -611,7 +859,9 @@ highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlope
 lowcutBypassButtonAttachment(audioProcessor.apvts, "LowCut Bypassed", lowcutBypassButton),
 peakBypassButtonAttachment(audioProcessor.apvts, "Peak Bypassed", peakBypassButton),
 highcutBypassButtonAttachment(audioProcessor.apvts, "HighCut Bypassed", highcutBypassButton),
-analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyzerEnabledButton)
+analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyzerEnabledButton),
+
+loadMeterComponent(audioProcessor.loadMeter)
 {
     
     peakFreqSlider.labels.add({0.f, "20Hz"});
@@ -635,6 +885,31 @@ analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyz
     highCutSlopeSlider.labels.add({0.f, "12"});
     highCutSlopeSlider.labels.add({1.f, "48"});
     
+    // The attachment selects the saved choice, so the items have to be there first
+    if (auto* controlRate = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Control Rate")))
+        controlRateBox.addItemList(controlRate->choices, 1);
+    controlRateAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Control Rate", controlRateBox);
+    
+    if (auto* analyzerOverlap = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Analyzer Overlap")))
+        analyzerOverlapBox.addItemList(analyzerOverlap->choices, 1);
+    analyzerOverlapAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Analyzer Overlap", analyzerOverlapBox);
+    
+    if (auto* analyzerResolution = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Analyzer Resolution")))
+        analyzerResolutionBox.addItemList(analyzerResolution->choices, 1);
+    analyzerResolutionAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Analyzer Resolution", analyzerResolutionBox);
+    
+    if (auto* analyzerAveraging = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Analyzer Averaging")))
+        analyzerAveragingBox.addItemList(analyzerAveraging->choices, 1);
+    analyzerAveragingAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Analyzer Averaging", analyzerAveragingBox);
+    
+    if (auto* analyzerPeakHold = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Analyzer Peak Hold")))
+        analyzerPeakHoldBox.addItemList(analyzerPeakHold->choices, 1);
+    analyzerPeakHoldAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Analyzer Peak Hold", analyzerPeakHoldBox);
+    
+    if (auto* analyzerSmoothing = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Analyzer Smoothing")))
+        analyzerSmoothingBox.addItemList(analyzerSmoothing->choices, 1);
+    analyzerSmoothingAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Analyzer Smoothing", analyzerSmoothingBox);
+    
     for ( auto* comp : getComps() )
     {
         addAndMakeVisible(comp);
@@ -686,7 +961,10 @@ analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyz
         }
     };
     
-    setSize (600, 480);
+    // onClick only fires on clicks, so pick up the saved state here
+    responseCurveComponent.toggleAnalysisEnablement(analyzerEnabledButton.getToggleState());
+    
+    setSize (900, 480);
 }
 
 SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
@@ -712,6 +990,13 @@ void SimpleEQAudioProcessorEditor::resized()
     // the bottom 2/3rds will be for all the sliders
     auto bounds = getLocalBounds();
     auto analyzerEnabledArea = bounds.removeFromTop(25);
+    controlRateBox.setBounds(analyzerEnabledArea.removeFromRight(110).reduced(5, 2));
+    analyzerOverlapBox.setBounds(analyzerEnabledArea.removeFromRight(120).reduced(5, 2));
+    analyzerResolutionBox.setBounds(analyzerEnabledArea.removeFromRight(110).reduced(5, 2));
+    analyzerAveragingBox.setBounds(analyzerEnabledArea.removeFromRight(120).reduced(5, 2));
+    analyzerPeakHoldBox.setBounds(analyzerEnabledArea.removeFromRight(120).reduced(5, 2));
+    analyzerSmoothingBox.setBounds(analyzerEnabledArea.removeFromRight(110).reduced(5, 2));
+    loadMeterComponent.setBounds(analyzerEnabledArea.removeFromRight(80).reduced(5, 4));
     analyzerEnabledArea.setWidth(100);
     analyzerEnabledArea.setX(5);
     analyzerEnabledArea.removeFromTop(2);
@@ -760,6 +1045,13 @@ std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps()
         &lowcutBypassButton,
         &peakBypassButton,
         &highcutBypassButton,
-        &analyzerEnabledButton
+        &analyzerEnabledButton,
+        &controlRateBox,
+        &analyzerOverlapBox,
+        &analyzerResolutionBox,
+        &analyzerAveragingBox,
+        &analyzerPeakHoldBox,
+        &analyzerSmoothingBox,
+        &loadMeterComponent
     };
 }
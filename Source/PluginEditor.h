@@ -18,71 +18,292 @@ enum FFTOrder
     order8192 = 13
 };
 
+constexpr int minFFTOrder = order2048, maxFFTOrder = order8192;
+constexpr int numFFTOrders = maxFFTOrder - minFFTOrder + 1;
+
+// log2 from the float's exponent plus a quadratic on its mantissa, good to about 0.005, i.e.
+// 0.015 dB. Branch free, so a loop of these vectorises
+inline float fastLog2(float x) noexcept
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    auto exponent = (float)((int)(bits >> 23) - 128);
+    
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    float mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(mantissa));
+    
+    return exponent + (-0.34484843f * mantissa + 2.02466578f) * mantissa - 0.67487759f;
+}
+
+// Fractional-octave smoothing of a power spectrum in constant time per bin. Bin k is replaced by
+// the mean power of the bins within 1/(2 * fraction) of an octave either side of it, read off a
+// prefix sum as (sum[high + 1] - sum[low]) / count. Each bin's window edges are worked out once
+// for a given number of bins and fraction and kept until either changes. Being ratios of bin
+// indices, the edges don't depend on the sample rate
+struct FractionalOctaveSmoother
+{
+    // Sizes everything for the largest spectrum, so setup() and process() never allocate
+    void prepare(int maxNumBins)
+    {
+        lowEdges.assign((size_t)maxNumBins, 0);
+        highEdges.assign((size_t)maxNumBins, 0);
+        prefixSum.assign((size_t)maxNumBins + 1, 0.0);
+    }
+    
+    void setup(int numBins, int octaveFraction)
+    {
+        jassert(numBins <= (int)lowEdges.size());
+        
+        if (numBins == edgesNumBins && octaveFraction == edgesFraction)
+            return;
+        
+        edgesNumBins = numBins;
+        edgesFraction = octaveFraction;
+        
+        if (octaveFraction <= 0)
+            return;
+        
+        auto halfWidth = std::pow(2.0, 0.5 / octaveFraction);
+        
+        for (int i = 0; i < numBins; ++i)
+        {
+            lowEdges[(size_t)i] = juce::jmin(i, juce::roundToInt(i / halfWidth));
+            highEdges[(size_t)i] = juce::jlimit(i, numBins - 1, juce::roundToInt(i * halfWidth));
+        }
+    }
+    
+    // Smooths the first numBins values set up for, in place
+    void process(float* power) noexcept
+    {
+        if (edgesFraction <= 0)
+            return;
+        
+        // In doubles: the differences of large sums have to keep the quiet bins' detail
+        prefixSum[0] = 0.0;
+        for (int i = 0; i < edgesNumBins; ++i)
+            prefixSum[(size_t)i + 1] = prefixSum[(size_t)i] + power[i];
+        
+        for (int i = 0; i < edgesNumBins; ++i)
+        {
+            auto low = lowEdges[(size_t)i], high = highEdges[(size_t)i];
+            power[i] = (float)((prefixSum[(size_t)high + 1] - prefixSum[(size_t)low]) / (high - low + 1));
+        }
+    }
+    
+private:
+    std::vector<int> lowEdges, highEdges;
+    std::vector<double> prefixSum;
+    int edgesNumBins = 0, edgesFraction = 0;
+};
+
+// Analyses both channels with one complex FFT: left goes in the real part, right in the
+// imaginary part, and the two spectra are pulled apart again using the conjugate symmetry of a
+// real signal's transform. Z = FFT(l + i r) gives
+//     L[k] = (Z[k] + conj(Z[N - k])) / 2
+//     R[k] = (Z[k] - conj(Z[N - k])) / 2i
+// so one fftSize complex transform does the work of the two frequency-only ones it replaces
 template<typename BlockType>
-struct FFTDataGenerator
+struct StereoFFTDataGenerator
 {
-    // produces the FFT data from an audio buffer
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
+    using Complex = juce::dsp::Complex<float>;
+    
+    StereoFFTDataGenerator()
+    {
+        // Room for the largest order up front, so switching never has to grow anything
+        auto maxFFTSize = (size_t)1 << maxFFTOrder;
+        
+        leftFrame.resize(maxFFTSize, 0.f);
+        rightFrame.resize(maxFFTSize, 0.f);
+        
+        for (auto& channel : channels)
+            channel.prepare(maxFFTSize / 2);
+        
+        smoother.prepare((int)maxFFTSize / 2);
+    }
+    
+    // produces dB spectra for both channels from the newest fftSize samples of circular histories
+    // historySize long, where writeIndex is the slot the next sample will go in.
+    // Each bin's dB value is averaged into the last frame's by averagingCoefficient (0 for none),
+    // and the peaks fall by peakDecayInDecibels unless the new frame is higher (an infinite decay
+    // makes them follow the frame)
+    void produceFFTDataForRendering(const float* leftHistory, const float* rightHistory, int historySize, int writeIndex, const float negativeInfinity,
+                                    float averagingCoefficient, float peakDecayInDecibels)
     {
+        jassert(current != nullptr);
+        
         const auto fftSize = getFFTSize();
+        auto& timeData = current->timeData;
+        auto& frequencyData = current->frequencyData;
         
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
+        copyFrame(leftHistory, historySize, writeIndex, leftFrame);
+        copyFrame(rightHistory, historySize, writeIndex, rightFrame);
         
         // firtst apply a windowing function to our data
-        window->multiplyWithWindowingTable (fftData.data(), fftSize);
+        current->window.multiplyWithWindowingTable (leftFrame.data(), (size_t)fftSize);
+        current->window.multiplyWithWindowingTable (rightFrame.data(), (size_t)fftSize);
+        
+        for (int i = 0; i < fftSize; ++i)
+            timeData[i] = { leftFrame[i], rightFrame[i] };
         
         // then render our FFT data
-        forwardFFT->performFrequencyOnlyForwardTransform (fftData.data());
+        current->forwardFFT.perform(timeData.data(), frequencyData.data(), false);
         
         int numBins = (int)fftSize / 2;
+        auto* leftPower = channels[0].power.data();
+        auto* rightPower = channels[1].power.data();
         
-        // Normalize fft values
+        // Squared magnitudes, so no square roots: the dB conversion below takes care of them
         for (int i = 0; i < numBins; ++i)
         {
+            auto z = frequencyData[i];
+            auto mirror = std::conj(frequencyData[(fftSize - i) & (fftSize - 1)]);
             
-            fftData[i] /= (float) numBins;
+            leftPower[i] = std::norm(z + mirror);
+            rightPower[i] = std::norm(z - mirror);
         }
         
-        // convert them to decibels
-        for (int i = 0; i < numBins; ++i)
-        {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
+        // Smoothed as power, before anything goes logarithmic
+        smoother.setup(numBins, smoothingFraction);
+        smoother.process(leftPower);
+        smoother.process(rightPower);
+        
+        // |Z[k] +- conj(Z[N - k])| / 2, normalized by numBins as before, squared
+        auto normalisation = 0.25f / ((float)numBins * (float)numBins);
+        
+        // Straight to the new frame at first and after an order change: the old bins don't line up with these
+        for (auto& channel : channels)
+            channel.update(numBins, normalisation, negativeInfinity, averagingCoefficient, peakDecayInDecibels, resetSpectra);
         
-        fftDataFifo.push(fftData);
+        resetSpectra = false;
     }
     
-    void changeOrder(FFTOrder newOrder)
+    // Builds the FFT, window and scratch buffers for an order the first time it's asked for and
+    // keeps them. This is where the allocation happens, so call it off the analysis thread; it's
+    // safe to call while that thread is analysing with another order
+    void prepareOrder(FFTOrder newOrder)
     {
-        // whgen you change order, recreate the window, forwardFFT, fifo, fftData
-        // also reset the fifoIndex
-        // things that need recreating should be created on the heap via std::make_unique<>
-        order = newOrder;
-        auto fftSize = getFFTSize();
+        auto index = newOrder - minFFTOrder;
+        
+        if (resourcesReady[index].load(std::memory_order_acquire))
+            return;
         
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        resources[index] = std::make_unique<OrderResources>(newOrder);
+        resourcesReady[index].store(true, std::memory_order_release);
+    }
+    
+    // Analysis thread. Switches to an order whose resources prepareOrder() has already built,
+    // which is only a pointer change. Returns false, and keeps the current order, if they aren't
+    // ready yet
+    bool changeOrder(FFTOrder newOrder)
+    {
+        auto index = newOrder - minFFTOrder;
         
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
+        if (! resourcesReady[index].load(std::memory_order_acquire))
+            return false;
         
-        fftDataFifo.prepare(fftData.size());
+        order = newOrder;
+        current = resources[index].get();
+        resetSpectra = true;
+        return true;
     }
     
+    FFTOrder getOrder() const { return order; }
     int getFFTSize() const { return 1 << order; }
-    int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
-    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
+    
+    // 1/octaveFraction octave smoothing from the next frame on, 0 for none
+    void setSmoothing(int octaveFraction) { smoothingFraction = juce::jmax(0, octaveFraction); }
+    
+    // The last frame's spectra, 0 for left and 1 for right. Only the first fftSize / 2 bins are
+    // in use; they stay put until the next produceFFTDataForRendering()
+    const BlockType& getSpectrum(int channel) const { return channels[(size_t)channel].decibels; }
+    const BlockType& getPeaks(int channel) const { return channels[(size_t)channel].peaks; }
     
 private:
-    FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
-    Fifo<BlockType> fftDataFifo;
+    // One channel's persistent spectrum state
+    struct ChannelSpectrum
+    {
+        void prepare(size_t maxNumBins)
+        {
+            power.assign(maxNumBins, 0.f);
+            decibels.assign(maxNumBins, -std::numeric_limits<float>::infinity());
+            peaks.assign(maxNumBins, -std::numeric_limits<float>::infinity());
+        }
+        
+        // Normalisation, dB conversion, averaging and peak hold in one pass over the bins.
+        // With reset, the average and the peaks start again from this frame: blending into the
+        // -infinity they're prepared with would give 0 * -inf, a NaN that the average never loses
+        void update(int numBins, float normalisation, float negativeInfinity, float averagingCoefficient, float peakDecayInDecibels, bool reset) noexcept
+        {
+            // 10 * log10(x) = 10 * log10(2) * log2(x)
+            constexpr float decibelsPerOctave = 3.0102999566f;
+            
+            auto* p = power.data();
+            auto* d = decibels.data();
+            auto* h = peaks.data();
+            
+            if (reset)
+            {
+                for (int i = 0; i < numBins; ++i)
+                    d[i] = h[i] = juce::jmax(negativeInfinity, decibelsPerOctave * fastLog2(p[i] * normalisation));
+                
+                return;
+            }
+            
+            for (int i = 0; i < numBins; ++i)
+            {
+                auto newDecibels = juce::jmax(negativeInfinity, decibelsPerOctave * fastLog2(p[i] * normalisation));
+                d[i] = newDecibels + averagingCoefficient * (d[i] - newDecibels);
+                h[i] = juce::jmax(newDecibels, h[i] - peakDecayInDecibels);
+            }
+        }
+        
+        std::vector<float> power;
+        BlockType decibels, peaks;
+    };
+    
+    // Everything that depends on the order
+    struct OrderResources
+    {
+        OrderResources(FFTOrder o) :
+        forwardFFT(o),
+        window((size_t)1 << o, juce::dsp::WindowingFunction<float>::blackmanHarris),
+        timeData((size_t)1 << o),
+        frequencyData((size_t)1 << o)
+        { }
+        
+        juce::dsp::FFT forwardFFT;
+        juce::dsp::WindowingFunction<float> window;
+        std::vector<Complex> timeData, frequencyData;
+    };
+    
+    // The newest fftSize samples put together in order, in at most two copies
+    void copyFrame(const float* history, int historySize, int writeIndex, std::vector<float>& frame) const
+    {
+        const auto fftSize = getFFTSize();
+        auto start = (writeIndex - fftSize + historySize) % historySize;
+        auto first = juce::jmin(fftSize, historySize - start);
+        std::copy(history + start, history + start + first, frame.begin());
+        std::copy(history, history + fftSize - first, frame.begin() + first);
+    }
+    
+    FFTOrder order = order2048;
+    OrderResources* current = nullptr;
+    std::array<std::unique_ptr<OrderResources>, numFFTOrders> resources;
+    std::array<std::atomic<bool>, numFFTOrders> resourcesReady {};
+    
+    std::vector<float> leftFrame, rightFrame;
+    std::array<ChannelSpectrum, 2> channels;
+    bool resetSpectra = true;
+    
+    FractionalOctaveSmoother smoother;
+    int smoothingFraction = 0;
 };
 
+// Draws a spectrum with one vertex per pixel column. Which bins fall in each column is worked
+// out once per width, FFT size and bin width and kept in a table, so a frame is just a lookup:
+// a column that several bins land in shows the loudest of them, and one that no bin lands in
+// (low frequencies, where the bins are sparse) is interpolated at its centre frequency
 template<typename PathType>
 struct AnalyzerPathGenerator
 {
@@ -94,37 +315,52 @@ struct AnalyzerPathGenerator
     {
         auto top = fftBounds.getY();
         auto bottom = fftBounds.getHeight();
-        auto width = fftBounds.getWidth();
+        auto width = (int)fftBounds.getWidth();
         
         int numBins = (int)fftSize / 2;
         
-        PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+        if (width <= 0 || numBins < 2)
+            return;
+        
+        updateColumns(width, numBins, binWidth);
         
         auto map = [bottom, top, negativeInfinity](float v)
         {
             return juce::jmap(v, negativeInfinity, 0.f, float(bottom), top);
         };
         
-        auto y = map(renderData[0]);
-        jassert( !std::isnan(y) && !std::isinf(y) );
-        p.startNewSubPath(0, y);
-        const int pathResolution = 2;
-        for (int binNum = 1; binNum < numBins; binNum += pathResolution)
+        path.clear();
+        path.preallocateSpace(3 * width);
+        
+        for (int x = 0; x < width; ++x)
         {
-            y = map(renderData[binNum]);
-            //jassert( !std::isnan(y) && !std::isinf(y) );
+            const auto& column = columns[(size_t)x];
+            float v;
             
-            if ( !std::isnan(y) && !std::isinf(y) )
+            if (column.firstBin <= column.lastBin)
+            {
+                v = renderData[(size_t)column.firstBin];
+                for (int binNum = column.firstBin + 1; binNum <= column.lastBin; ++binNum)
+                    v = juce::jmax(v, renderData[(size_t)binNum]);
+            }
+            else
             {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
+                auto lower = renderData[(size_t)column.lowerBin];
+                v = lower + column.fraction * (renderData[(size_t)column.lowerBin + 1] - lower);
             }
+            
+            auto y = map(v);
+            
+            if ( std::isnan(y) || std::isinf(y) )
+                continue;
+            
+            if (path.isEmpty())
+                path.startNewSubPath((float)x, y);
+            else
+                path.lineTo((float)x, y);
         }
         
-        pathFifo.push(p);
+        pathFifo.push(path);
     }
     
     int getNumPathsAvailable() const
@@ -137,6 +373,50 @@ struct AnalyzerPathGenerator
         return pathFifo.pull(path);
     }
 private:
+    struct Column
+    {
+        // The bins drawn at this column. Empty when firstBin > lastBin
+        int firstBin = 0, lastBin = -1;
+        // Otherwise, where the column's centre frequency falls between two bins
+        int lowerBin = 0;
+        float fraction = 0.f;
+    };
+    
+    void updateColumns(int width, int numBins, float binWidth)
+    {
+        if (width == columnsWidth && numBins == columnsNumBins && binWidth == columnsBinWidth)
+            return;
+        
+        columnsWidth = width;
+        columnsNumBins = numBins;
+        columnsBinWidth = binWidth;
+        columns.resize((size_t)width);
+        
+        // The first bin at or above the frequency at pixel x, drawing from 20 Hz to 20 kHz as before
+        auto firstBinFrom = [width, numBins, binWidth](double x)
+        {
+            auto freq = juce::mapToLog10(x / width, 20.0, 20000.0);
+            return juce::jlimit(1, numBins, (int)std::ceil(freq / binWidth));
+        };
+        
+        for (int x = 0; x < width; ++x)
+        {
+            auto& column = columns[(size_t)x];
+            column.firstBin = firstBinFrom(x);
+            column.lastBin = firstBinFrom(x + 1) - 1;
+            
+            auto position = juce::jlimit(1.0, (double)numBins - 1.0,
+                                         juce::mapToLog10((x + 0.5) / width, 20.0, 20000.0) / binWidth);
+            column.lowerBin = juce::jmin((int)position, numBins - 2);
+            column.fraction = (float)(position - column.lowerBin);
+        }
+    }
+    
+    std::vector<Column> columns;
+    int columnsWidth = 0, columnsNumBins = 0;
+    float columnsBinWidth = 0.f;
+    
+    PathType path;
     Fifo<PathType> pathFifo;
 };
 
@@ -194,25 +474,146 @@ private:
 
 struct PathProducer
 {
-    PathProducer(SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>& scsf) :
-    leftChannelFifo(&scsf)
+    PathProducer()
+    {
+        fftDataGenerator.prepareOrder(FFTOrder::order2048);
+        fftDataGenerator.changeOrder(FFTOrder::order2048);
+        
+        // Long enough for the largest order, so a new order has a full frame to analyse straight away
+        auto maxFFTSize = (size_t)1 << maxFFTOrder;
+        leftHistory.resize(maxFFTSize, 0.f);
+        rightHistory.resize(maxFFTSize, 0.f);
+    }
+    // Takes the samples captured since the last call. Once at least hopSize of them have come in
+    // since the last FFT, the newest fftSize are analysed, but never more than once per call: with
+    // one call per display frame, the FFT rate is the lower of the hop rate and the frame rate
+    // whatever size the host's blocks are. Returns true if the paths have changed
+    bool process(const float* leftSamples, const float* rightSamples, int numSamples, juce::Rectangle<float> fftBounds, double sampleRate);
+    juce::Path getLeftPath() { return leftChannelFFTPath; }
+    juce::Path getRightPath() { return rightChannelFFTPath; }
+    // Empty while peak hold is off
+    juce::Path getLeftPeakPath() { return leftPeakPath; }
+    juce::Path getRightPeakPath() { return rightPeakPath; }
+    
+    int getFFTSize() const { return fftDataGenerator.getFFTSize(); }
+    void setHopSize(int numSamples) { hopSize = juce::jlimit(1, getFFTSize(), numSamples); }
+    
+    // Time constant of the exponential average over frames, 0 for none
+    void setAveragingTime(double seconds) { averagingTime = juce::jmax(0.0, seconds); }
+    // How fast held peaks fall, 0 to turn peak hold off
+    void setPeakDecayRate(double decibelsPerSecond) { peakDecayRate = juce::jmax(0.0, decibelsPerSecond); }
+    // 1/octaveFraction octave smoothing, 0 for none
+    void setSmoothing(int octaveFraction) { fftDataGenerator.setSmoothing(octaveFraction); }
+    
+    // Any thread but the one calling process(): builds an order's resources the first time
+    void prepareOrder(FFTOrder newOrder) { fftDataGenerator.prepareOrder(newOrder); }
+    // Same thread as process(). Once the order is prepared, the next process() call analyses the
+    // newest frame at the new size, so the display carries straight on
+    void changeOrder(FFTOrder newOrder);
+    
+    // Forgets the captured history and the hop and frame counts, e.g. before resuming after a gap
+    void reset();
+    
+    // Hop size for each "Analyzer Overlap" choice
+    static int getHopSize(int fftSize, int overlapIndex) { return juce::jmax(1, fftSize >> juce::jlimit(0, 3, overlapIndex)); }
+    // FFT order for each "Analyzer Resolution" choice. Auto keeps the bins about 20 Hz wide
+    static FFTOrder getOrder(int resolutionIndex, double sampleRate);
+    // Settings for each "Analyzer Averaging", "Analyzer Peak Hold" and "Analyzer Smoothing" choice
+    static double getAveragingTime(int averagingIndex);
+    static double getPeakDecayRate(int peakHoldIndex);
+    static int getSmoothingFraction(int smoothingIndex);
+    
+private:
+    // The last samples of each channel, enough for the largest order, written round and round.
+    // historyWriteIndex is where the next sample goes
+    std::vector<float> leftHistory, rightHistory;
+    int historyWriteIndex = 0;
+    
+    int hopSize = 1024, samplesSinceLastFFT = 0;
+    // Since the last frame was analysed, for timing the averaging and peak decay
+    juce::int64 samplesSinceLastFrame = 0;
+    
+    double averagingTime = 0.0, peakDecayRate = 0.0;
+    
+    StereoFFTDataGenerator<std::vector<float>> fftDataGenerator;
+    
+    AnalyzerPathGenerator<juce::Path> leftPathGenerator, rightPathGenerator;
+    AnalyzerPathGenerator<juce::Path> leftPeakPathGenerator, rightPeakPathGenerator;
+    
+    juce::Path leftChannelFFTPath, rightChannelFFTPath;
+    juce::Path leftPeakPath, rightPeakPath;
+};
+
+// What the analyzer worker hands the message thread for one frame
+struct AnalyzerPaths
+{
+    juce::Path left, right;
+    // Held peaks, empty while peak hold is off
+    juce::Path leftPeak, rightPeak;
+};
+
+// One editor's share of the analyzer worker: the processor's capture ring it reads, the path
+// producer it runs, and the triple buffer the finished paths are published through.
+// analyse() runs on the worker; everything else is for the message thread
+struct AnalyzerClient
+{
+    AnalyzerClient(SimpleEQAudioProcessor& p) : audioProcessor(p),
+    leftCapture((size_t)1 << maxFFTOrder),
+    rightCapture((size_t)1 << maxFFTOrder)
+    { }
+    
+    // Turning the analyzer back on starts it from live audio, not whatever was left in the tap
+    void setEnabled(bool shouldBeEnabled)
     {
-        leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
-        monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+        if (shouldBeEnabled && ! enabled.exchange(true))
+            needsResync = true;
+        
+        enabled = shouldBeEnabled;
     }
-    void process(juce::Rectangle<float> fftBounds, double sampleRate);
-    juce::Path getPath() { return leftChannelFFTPath; }
+    void setDisplayArea(juce::Rectangle<float> fftBounds, double sampleRate);
+    // Prepares the order if it's new, then has the worker switch to it on its next pass
+    void setFFTOrder(FFTOrder order);
+    
+    void analyse();
+    
+    TripleBuffer<AnalyzerPaths> paths;
     
 private:
-    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
+    SimpleEQAudioProcessor& audioProcessor;
+    std::atomic<bool> enabled { false };
+    // Set on registering and on enabling. The worker, as the tap's only reader, does the skipping
+    std::atomic<bool> needsResync { true };
+    std::atomic<int> fftOrder { order2048 };
     
-    juce::AudioBuffer<float> monoBuffer;
+    juce::SpinLock displayAreaLock;
+    juce::Rectangle<float> displayBounds;
+    double displaySampleRate = 44100.0;
     
-    FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
+    PathProducer pathProducer;
+    // The newest frame's worth of what the tap has collected since the last pass
+    std::vector<float> leftCapture, rightCapture;
+};
+
+// One background thread, shared by every editor in the process through a SharedResourcePointer,
+// runs each registered client's analysis once per display frame. The FFTs, windowing, dB
+// conversion and path building all happen here, so the message thread only swaps and paints.
+// The clients' rings are polled rather than signalled: waking the thread from processBlock would
+// put a system call on the audio thread
+struct AnalyzerWorker : juce::Thread
+{
+    AnalyzerWorker();
+    ~AnalyzerWorker() override;
+    
+    // Message thread. removeClient() waits for the client's own analysis to finish if it's running,
+    // never for a whole pass over every client
+    void addClient(AnalyzerClient* client);
+    void removeClient(AnalyzerClient* client);
     
-    AnalyzerPathGenerator<juce::Path> pathProducer;
+    void run() override;
     
-    juce::Path leftChannelFFTPath;
+private:
+    juce::CriticalSection clientLock;
+    juce::Array<AnalyzerClient*> clients;
 };
 
 struct ResponseCurveComponent: juce::Component,
@@ -230,6 +631,8 @@ juce::Timer
     void toggleAnalysisEnablement(bool enabled)
     {
         shouldShowFFTAnalysis = enabled;
+        analyzerClient.setEnabled(enabled);
+        repaint();
     }
     
 private:
@@ -237,14 +640,36 @@ private:
     juce::Atomic<bool> parametersChanged {false};
     MonoChain monoChain;
     void updateChain();
+    // Rebuilds responseCurve from monoChain for the current bounds
+    void updateResponseCurve();
+    juce::Path responseCurve;
+    double chainSampleRate = 0.0;
+    bool needsRepaint = true;
     juce::Image background;
     juce::Rectangle<int> getRenderArea();
     juce::Rectangle<int> getAnalysisArea();
     
-    PathProducer leftPathProducer, rightPathProducer;
+    AnalyzerClient analyzerClient;
+    juce::SharedResourcePointer<AnalyzerWorker> analyzerWorker;
     bool shouldShowFFTAnalysis = true;
 };
 
+// The share of the realtime budget processBlock is using, as a bar with the percentage on it.
+// It shows the worst block since the last refresh and falls back slowly, so a spike stays readable.
+// Clicking it saves a LoadMeter snapshot to a file
+struct LoadMeterComponent : juce::Component, juce::Timer
+{
+    LoadMeterComponent(LoadMeter& meter);
+    void timerCallback() override;
+    void paint(juce::Graphics& g) override;
+    void mouseUp(const juce::MouseEvent& e) override;
+
+private:
+    LoadMeter& loadMeter;
+    float displayedLoad = 0.f;
+    std::unique_ptr<juce::FileChooser> fileChooser;
+};
+
 struct PowerButton : juce::ToggleButton { };
 struct AnalyzerButton : juce::ToggleButton { };
 
@@ -296,6 +721,12 @@ private:
                      highcutBypassButtonAttachment,
                      analyzerEnabledButtonAttachment;
     
+    juce::ComboBox controlRateBox, analyzerOverlapBox, analyzerResolutionBox, analyzerAveragingBox, analyzerPeakHoldBox, analyzerSmoothingBox;
+    std::unique_ptr<APVTS::ComboBoxAttachment> controlRateAttachment, analyzerOverlapAttachment, analyzerResolutionAttachment,
+                                               analyzerAveragingAttachment, analyzerPeakHoldAttachment, analyzerSmoothingAttachment;
+    
+    LoadMeterComponent loadMeterComponent;
+    
     std::vector<juce::Component*> getComps();
 
     LookAndFeel lnf;
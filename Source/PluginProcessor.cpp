@@ -104,21 +104,28 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     spec.maximumBlockSize = samplesPerBlock;
     
     // Needs to know the number of channels
-    // We are making mono channels, so it can only handle 1
-    spec.numChannels = 1;
+    // Our chain handles every channel of the bus at once
+    spec.numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
     
     // Needs to know the sample rate
     spec.sampleRate = sampleRate;
     
-    // Now we can pass it to each chain
-    // We are making a leftChain and rightChain so we can combine two mono inputs into a single stereo one
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    // Now we can pass it to the chain
+    chain.prepare(spec);
+    fadingChain.prepare(spec);
     
-    updateFilters();
+    // Band transitions fade over 10 ms. processCrossfade() steps through blocks by this buffer's
+    // length, so it's never left empty even if the host reports a block size of 0
+    crossfadeBuffer.setSize((int)spec.numChannels, juce::jmax(1, samplesPerBlock));
+    crossfadeLength = juce::jmax(1, juce::roundToInt(sampleRate * 0.01));
     
-    leftChannelFifo.prepare(samplesPerBlock);
-    rightChannelFifo.prepare(samplesPerBlock);
+    // Design the first coefficient set synchronously so we never play with stale coefficients
+    controlRateScheduler.prepare(sampleRate);
+    updateFilters(controlRateScheduler.getCoefficients(), (1 << ChainPositions::LowCut) | (1 << ChainPositions::Peak) | (1 << ChainPositions::HighCut));
+    crossfadeSamplesRemaining = 0;
+    pendingBands = 0;
+    
+    loadMeter.prepare(sampleRate);
     
     osc.initialise([](float x) { return std::sin(x); });
     
@@ -132,6 +139,7 @@ void SimpleEQAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    controlRateScheduler.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -142,11 +150,15 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
+    // We support mono, stereo and the surround/immersive layouts up to 7.1.4.
     // Some plugin hosts, such as certain GarageBand versions, will only
     // load plugins that support stereo bus layouts.
-    if (//layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    const auto& output = layouts.getMainOutputChannelSet();
+    if (output != juce::AudioChannelSet::mono()
+     && output != juce::AudioChannelSet::stereo()
+     && output != juce::AudioChannelSet::create5point1()
+     && output != juce::AudioChannelSet::create7point1()
+     && output != juce::AudioChannelSet::create7point1point4())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -162,6 +174,7 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    auto timer = loadMeter.startBlock();
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -175,10 +188,7 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    updateFilters();
-        
-    // ProcessingChain requires a ProcessingContext to be passed to it in order to run the audio through the links in the chain
-    // to make a ProcessingContext we need to supply it with an AudioBlock instance
+    // The chain works on an AudioBlock wrapping our buffer
     juce::dsp::AudioBlock<float> block(buffer);
     
     
@@ -190,22 +200,104 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
 //    juce::dsp::ProcessContextReplacing<float> stereoContext(block);
 //    osc.process(stereoContext);
     
-    // Extracting channels from the buffer which will then be wrapped inside more audio blocks
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    // The block is worked through in control-rate sub-blocks. Coefficients only change at their
+    // boundaries, and only while a ramp is running: the rest of the block is done in one go
+    auto controlInterval = ControlRateScheduler::getControlInterval((int)parameterHandles.get(Param_ControlRate));
+    auto numSamples = (int)block.getNumSamples();
+    timer.lap(LoadMeter::Stage_Parameters);
+    
+    for (int start = 0; start < numSamples; )
+    {
+        // The ramp keeps moving during a crossfade. Only a step that would switch sections in or
+        // out waits for the fade to finish, and then whatever step the ramp has reached is applied
+        pendingBands |= controlRateScheduler.advance();
+        
+        const auto& coefficients = controlRateScheduler.getCoefficients();
+        
+        if (pendingBands != 0 && (crossfadeSamplesRemaining == 0 || ! changesActiveSections(appliedSettings, coefficients.settings)))
+        {
+            updateFilters(coefficients, pendingBands);
+            pendingBands = 0;
+            timer.lap(LoadMeter::Stage_Coefficients);
+        }
+        else
+        {
+            timer.lap(LoadMeter::Stage_Parameters);
+        }
+        
+        auto length = numSamples - start;
+        if (crossfadeSamplesRemaining > 0 || controlRateScheduler.isRamping())
+            length = juce::jmin(length, controlInterval);
+        
+        auto subBlock = block.getSubBlock((size_t)start, (size_t)length);
+        
+        // Channels are filtered in groups, one per SIMD lane.
+        // With every band flat there is nothing to do and the audio passes straight through
+        if (crossfadeSamplesRemaining > 0)
+            processCrossfade(subBlock);
+        else if (! chain.isIdentity())
+            chain.process(subBlock);
+        
+        controlRateScheduler.samplesProcessed(length);
+        timer.lap(LoadMeter::Stage_DSP);
+        start += length;
+    }
     
-    // Now we can create ProcessingContexts that wrap each individual audio block for the channels
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    // Nobody reads the tap while the analyzer is off
+    if (parameterHandles.get(Param_AnalyzerEnabled) > 0.5f)
+        analyzerTap.push(buffer);
     
-    // Now we have block representing each individual channel
-    // We also have a context that provides a wrap around the block that the chain uses
-    // Now we can pass the context to the chains
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    timer.lap(LoadMeter::Stage_Analyzer);
+    loadMeter.endBlock(timer, numSamples);
+}
+
+void SimpleEQAudioProcessor::processCrossfade(const juce::dsp::AudioBlock<float>& block)
+{
+    auto numChannels = juce::jmin(block.getNumChannels(), (size_t)crossfadeBuffer.getNumChannels());
+    auto numSamples = block.getNumSamples();
+    auto chunkSize = (size_t)crossfadeBuffer.getNumSamples();
     
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    for (size_t start = 0; start < numSamples; start += chunkSize)
+    {
+        auto length = juce::jmin(numSamples - start, chunkSize);
+        auto chunk = block.getSubBlock(start, length);
+        
+        // The old chain works on a copy, the new one in place
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            crossfadeBuffer.copyFrom((int)ch, 0, chunk.getChannelPointer(ch), (int)length);
+        
+        juce::dsp::AudioBlock<float> oldBlock(crossfadeBuffer.getArrayOfWritePointers(), numChannels, length);
+        fadingChain.process(oldBlock);
+        chain.process(chunk);
+        
+        // Linear ramp from the old output to the new one
+        auto fadeSamples = juce::jmin((int)length, crossfadeSamplesRemaining);
+        auto step = 1.f / (float)crossfadeLength;
+        auto startGain = 1.f - (float)crossfadeSamplesRemaining * step;
+        
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            auto* newSamples = chunk.getChannelPointer(ch);
+            const auto* oldSamples = crossfadeBuffer.getReadPointer((int)ch);
+            
+            for (int i = 0; i < fadeSamples; ++i)
+            {
+                auto gain = startGain + (float)i * step;
+                newSamples[i] = oldSamples[i] + gain * (newSamples[i] - oldSamples[i]);
+            }
+        }
+        
+        crossfadeSamplesRemaining -= fadeSamples;
+        
+        // Once the fade is over, whatever is left of the block only needs the new chain
+        if (crossfadeSamplesRemaining == 0)
+        {
+            auto next = start + length;
+            if (next < numSamples)
+                chain.process(block.getSubBlock(next, numSamples - next));
+            break;
+        }
+    }
 }
 
 //==============================================================================
@@ -233,88 +325,1035 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     if (tree.isValid())
     {
         apvts.replaceState(tree);
-        updateFilters();
+        controlRateScheduler.triggerUpdate();
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+const char* getParameterID(Params param)
+{
+    static constexpr std::array<const char*, Param_NumParams> ids
+    {
+        "LowCut Freq",
+        "HighCut Freq",
+        "Peak Freq",
+        "Peak Gain",
+        "Peak Quality",
+        "LowCut Slope",
+        "HighCut Slope",
+        "LowCut Bypassed",
+        "Peak Bypassed",
+        "HighCut Bypassed",
+        "Analyzer Enabled",
+        "Control Rate",
+        "Analyzer Overlap",
+        "Analyzer Resolution",
+        "Analyzer Averaging",
+        "Analyzer Peak Hold",
+        "Analyzer Smoothing"
+    };
+    
+    return ids[param];
+}
+
+ParameterHandles::ParameterHandles(juce::AudioProcessorValueTreeState& apvts)
+{
+    // The only place we look parameters up by string
+    for (int i = 0; i < Param_NumParams; ++i)
+    {
+        values[i] = apvts.getRawParameterValue(getParameterID(static_cast<Params>(i)));
+        jassert(values[i] != nullptr);
+    }
+}
+
+ChainSettings getChainSettings(const ParameterHandles& params)
 {
     ChainSettings settings;
     
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HighCut Slope")->load());
+    settings.lowCutFreq = params.get(Param_LowCutFreq);
+    settings.highCutFreq = params.get(Param_HighCutFreq);
+    settings.peakFreq = params.get(Param_PeakFreq);
+    settings.peakGainInDecibels = params.get(Param_PeakGain);
+    settings.peakQuality = params.get(Param_PeakQuality);
+    settings.lowCutSlope = static_cast<Slope>(params.get(Param_LowCutSlope));
+    settings.highCutSlope = static_cast<Slope>(params.get(Param_HighCutSlope));
     
-    settings.lowCutBypassed = apvts.getRawParameterValue("LowCut Bypassed")->load() > 0.5f;
-    settings.peakBypassed = apvts.getRawParameterValue("Peak Bypassed")->load() > 0.5f;
-    settings.highCutBypassed = apvts.getRawParameterValue("HighCut Bypassed")->load() > 0.5f;
+    settings.lowCutBypassed = params.get(Param_LowCutBypassed) > 0.5f;
+    settings.peakBypassed = params.get(Param_PeakBypassed) > 0.5f;
+    settings.highCutBypassed = params.get(Param_HighCutBypassed) > 0.5f;
     
     return settings;
 }
 
+bool isBandIdentity(const ChainSettings& chainSettings, ChainPositions band)
+{
+    switch (band)
+    {
+        case ChainPositions::LowCut:
+            return chainSettings.lowCutBypassed || chainSettings.lowCutFreq <= 20.f;
+        case ChainPositions::Peak:
+            return chainSettings.peakBypassed || chainSettings.peakGainInDecibels == 0.f;
+        case ChainPositions::HighCut:
+            return chainSettings.highCutBypassed || chainSettings.highCutFreq >= 20000.f;
+    }
+    
+    return false;
+}
+
+bool changesActiveSections(const ChainSettings& from, const ChainSettings& to)
+{
+    for (auto band : { ChainPositions::LowCut, ChainPositions::Peak, ChainPositions::HighCut })
+    {
+        if (isBandIdentity(from, band) != isBandIdentity(to, band))
+            return true;
+    }
+    
+    // A different slope on a cut that's in the chain changes how many of its sections run
+    if (! isBandIdentity(to, ChainPositions::LowCut) && from.lowCutSlope != to.lowCutSlope)
+        return true;
+    
+    return ! isBandIdentity(to, ChainPositions::HighCut) && from.highCutSlope != to.highCutSlope;
+}
+
+double BiquadCoefficients::getMagnitudeForFrequency(double frequency, double sampleRate) const noexcept
+{
+    // Evaluate H(z) on the unit circle, z^-1 = e^(-jw)
+    const auto [b0, b1, b2, a1, a2] = coefficients;
+    
+    auto w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    std::complex<double> z1 = std::polar(1.0, -w);
+    std::complex<double> z2 = z1 * z1;
+    
+    auto numerator = (double)b0 + (double)b1 * z1 + (double)b2 * z2;
+    auto denominator = 1.0 + (double)a1 * z1 + (double)a2 * z2;
+    
+    return std::abs(numerator / denominator);
+}
+
+// Same RBJ peaking EQ as juce::dsp::IIR::Coefficients::makePeakFilter, without the allocation
 Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality, juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+    auto gainFactor = juce::Decibels::decibelsToGain((double)chainSettings.peakGainInDecibels);
+    
+    auto A = std::sqrt(juce::jmax(0.0, gainFactor));
+    auto omega = juce::MathConstants<double>::twoPi * juce::jmax((double)chainSettings.peakFreq, 2.0) / sampleRate;
+    auto alpha = std::sin(omega) / (chainSettings.peakQuality * 2.0);
+    auto c2 = -2.0 * std::cos(omega);
+    auto alphaTimesA = alpha * A;
+    auto alphaOverA = alpha / A;
+    
+    auto a0 = 1.0 + alphaOverA;
+    
+    Coefficients peak;
+    peak.coefficients = { float((1.0 + alphaTimesA) / a0),
+                          float(c2 / a0),
+                          float((1.0 - alphaTimesA) / a0),
+                          float(c2 / a0),
+                          float((1.0 - alphaOverA) / a0) };
+    return peak;
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings)
+int designButterworthCut(CutCoefficients& sections, bool isHighPass, float frequency, double sampleRate, int order)
 {
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
+    jassert(sampleRate > 0);
+    jassert(frequency > 0 && frequency <= sampleRate * 0.5);
+    jassert(order > 0 && order % 2 == 0 && order / 2 <= (int)sections.size());
     
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
+    // An even order Butterworth filter factors into order / 2 second order sections.
+    // Section i has poles at angle (2i + 1) * pi / (2 * order), which gives it Q = 1 / (2 cos(angle)).
+    // Each section goes through the bilinear transform, pre-warped so the cutoff lands on `frequency`
+    auto numSections = juce::jmin(order / 2, (int)sections.size());
+    auto k = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+    auto kSquared = k * k;
     
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    for (int i = 0; i < numSections; ++i)
+    {
+        auto angle = (2.0 * i + 1.0) * juce::MathConstants<double>::pi / (order * 2.0);
+        auto invQ = 2.0 * std::cos(angle);
+        
+        auto a0 = 1.0 + invQ * k + kSquared;
+        auto a1 = 2.0 * (kSquared - 1.0) / a0;
+        auto a2 = (1.0 - invQ * k + kSquared) / a0;
+        
+        // Low pass zeros sit at Nyquist, high pass zeros at DC
+        auto b0 = (isHighPass ? 1.0 : kSquared) / a0;
+        auto b1 = (isHighPass ? -2.0 : 2.0) * b0;
+        
+        sections[i].coefficients = { float(b0), float(b1), float(b0), float(a1), float(a2) };
+    }
+    
+    return numSections;
+}
+
+void SimpleEQAudioProcessor::updatePeakFilter(const ChainCoefficients &chainCoefficients)
+{
+    chain.setPeak(chainCoefficients.peak, isBandIdentity(chainCoefficients.settings, ChainPositions::Peak));
 }
 
 void updateCoefficients(Coefficients &old, const Coefficients &replacements)
 {
-    *old = *replacements;
+    old = replacements;
 }
 
 // We could technically simplify this further by making a function for cutFilters
 // then passing in a variable to determine whether it's highCut or lowCut, but
 // for now this will suffice
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings)
+void SimpleEQAudioProcessor::updateLowCutFilters(const ChainCoefficients &chainCoefficients)
+{
+    const auto& chainSettings = chainCoefficients.settings;
+    chain.setLowCut(chainCoefficients.lowCut, chainSettings.lowCutSlope, isBandIdentity(chainSettings, ChainPositions::LowCut));
+}
+
+void SimpleEQAudioProcessor::updateHighCutFilters(const ChainCoefficients &chainCoefficients)
+{
+    const auto& chainSettings = chainCoefficients.settings;
+    chain.setHighCut(chainCoefficients.highCut, chainSettings.highCutSlope, isBandIdentity(chainSettings, ChainPositions::HighCut));
+}
+
+void SimpleEQAudioProcessor::updateFilters(const ChainCoefficients& chainCoefficients, int changedBands)
+{
+    // Keep the chain as it was when a band is about to switch in or out, so we can fade across
+    if (changesActiveSections(appliedSettings, chainCoefficients.settings))
+    {
+        fadingChain.copyFiltersFrom(chain);
+        crossfadeSamplesRemaining = crossfadeLength;
+    }
+    
+    // Only touch the bands that were redesigned
+    if (changedBands & (1 << ChainPositions::LowCut))
+        updateLowCutFilters(chainCoefficients);
+    
+    if (changedBands & (1 << ChainPositions::Peak))
+        updatePeakFilter(chainCoefficients);
+    
+    if (changedBands & (1 << ChainPositions::HighCut))
+        updateHighCutFilters(chainCoefficients);
+    
+    appliedSettings = chainCoefficients.settings;
+}
+
+//==============================================================================
+void SIMDChain::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    jassert(spec.numChannels <= maxChannels);
+    
+    auto numGroups = (juce::jmax((size_t)spec.numChannels, (size_t)1) + numLanes - 1) / numLanes;
+    groups.resize(numGroups);
+    // At least one sample: process() steps through blocks by the scratch size, so an empty one
+    // from a host reporting a maximum block size of 0 would never get anywhere
+    interleaved.assign(juce::jlimit((size_t)1, tileSize, (size_t)spec.maximumBlockSize), SIMDFloat::expand(0.f));
+    reset();
+    
+   #if SIMPLEEQ_TIME_PARALLEL_IIR
+    // Stereo and the surround layouts fill their groups two lanes or more at a time, so they never
+    // pay for the matrices. The coefficients may predate this layout, so bring them all up to date
+    hasSingleChannelGroup = spec.numChannels % numLanes == 1;
+    updateTimeParallelSections(Cascade::lowCutSections | Cascade::peakSections | Cascade::highCutSections);
+   #endif
+}
+
+void SIMDChain::reset()
+{
+    for (auto& group : groups)
+        group.reset();
+}
+
+void SIMDChain::resetSections(int sectionMask)
+{
+    // Sections that have just been switched on start from silence
+    for (int slot = 0; slot < Cascade::numSections; ++slot)
+    {
+        if (sectionMask & (1 << slot))
+        {
+            for (auto& group : groups)
+                group.resetSection(slot);
+        }
+    }
+}
+
+void SIMDChain::copyFiltersFrom(const SIMDChain& other)
+{
+    jassert(groups.size() == other.groups.size());
+    
+    cascade = other.cascade;
+    groups = other.groups;
+    
+   #if SIMPLEEQ_TIME_PARALLEL_IIR
+    hasSingleChannelGroup = other.hasSingleChannelGroup;
+    
+    if (hasSingleChannelGroup)
+        timeParallelSections = other.timeParallelSections;
+   #endif
+}
+
+void SIMDChain::setLowCut(const CutCoefficients& coefficients, Slope slope, bool bypassed)
+{
+    resetSections(cascade.setLowCut(coefficients, slope, bypassed));
+    
+   #if SIMPLEEQ_TIME_PARALLEL_IIR
+    updateTimeParallelSections(Cascade::lowCutSections);
+   #endif
+}
+
+void SIMDChain::setPeak(const Coefficients& coefficients, bool bypassed)
+{
+    resetSections(cascade.setPeak(coefficients, bypassed));
+    
+   #if SIMPLEEQ_TIME_PARALLEL_IIR
+    updateTimeParallelSections(Cascade::peakSections);
+   #endif
+}
+
+void SIMDChain::setHighCut(const CutCoefficients& coefficients, Slope slope, bool bypassed)
+{
+    resetSections(cascade.setHighCut(coefficients, slope, bypassed));
+    
+   #if SIMPLEEQ_TIME_PARALLEL_IIR
+    updateTimeParallelSections(Cascade::highCutSections);
+   #endif
+}
+
+void SIMDChain::process(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto numChannels = juce::jmin(block.getNumChannels(), groups.size() * numLanes);
+    auto numSamples = block.getNumSamples();
+    auto* lanes = reinterpret_cast<float*>(interleaved.data());
+    
+    for (size_t group = 0; group * numLanes < numChannels; ++group)
+    {
+        auto firstChannel = group * numLanes;
+        auto channelsInGroup = juce::jmin(numLanes, numChannels - firstChannel);
+        
+       #if SIMPLEEQ_TIME_PARALLEL_IIR
+        // A lone channel would leave 3 of 4 lanes idle, so vectorise along time instead.
+        // Only if prepare() saw it coming, as otherwise the matrices aren't kept up to date
+        if (channelsInGroup == 1 && hasSingleChannelGroup)
+        {
+            processSingleChannel(block.getChannelPointer(firstChannel), numSamples, groups[group]);
+            continue;
+        }
+       #endif
+        
+        // One tile at a time. This also covers hosts sending more than maximumBlockSize
+        for (size_t start = 0; start < numSamples; start += interleaved.size())
+        {
+            auto chunkSize = juce::jmin(numSamples - start, interleaved.size());
+            
+            // Interleave, one channel per lane
+            for (size_t lane = 0; lane < channelsInGroup; ++lane)
+            {
+                auto* src = block.getChannelPointer(firstChannel + lane) + start;
+                for (size_t i = 0; i < chunkSize; ++i)
+                    lanes[i * numLanes + lane] = src[i];
+            }
+            
+            // The scratch is shared between groups, so a partial group has to silence its spare lanes
+            for (size_t lane = channelsInGroup; lane < numLanes; ++lane)
+            {
+                for (size_t i = 0; i < chunkSize; ++i)
+                    lanes[i * numLanes + lane] = 0.f;
+            }
+            
+            cascade.process(interleaved.data(), chunkSize, groups[group]);
+            
+            for (size_t lane = 0; lane < channelsInGroup; ++lane)
+            {
+                auto* dst = block.getChannelPointer(firstChannel + lane) + start;
+                for (size_t i = 0; i < chunkSize; ++i)
+                    dst[i] = lanes[i * numLanes + lane];
+            }
+        }
+    }
+}
+
+#if SIMPLEEQ_TIME_PARALLEL_IIR
+void SIMDChain::updateTimeParallelSections(int sectionMask)
+{
+    if (! hasSingleChannelGroup)
+        return;
+    
+    for (int slot = 0; slot < Cascade::numSections; ++slot)
+    {
+        if ((sectionMask & (1 << slot)) != 0 && cascade.isActive(slot))
+            timeParallelSections[slot].setCoefficients(cascade.getCoefficients(slot));
+    }
+}
+
+void SIMDChain::processSingleChannel(float* data, size_t numSamples, Cascade::State& state) noexcept
+{
+    // The channel's state lives in lane 0 of the group, so switching between this and the
+    // interleaved path (when the layout changes) needs no conversion
+    for (size_t start = 0; start < numSamples; start += tileSize)
+    {
+        auto tile = juce::jmin(numSamples - start, tileSize);
+        
+        for (int slot = 0; slot < Cascade::numSections; ++slot)
+        {
+            if (! cascade.isActive(slot))
+                continue;
+            
+            auto s1 = state.s1[slot].get(0);
+            auto s2 = state.s2[slot].get(0);
+            
+            timeParallelSections[slot].process(data + start, tile, s1, s2);
+            
+            state.s1[slot].set(0, s1);
+            state.s2[slot].set(0, s2);
+        }
+    }
+}
+
+//==============================================================================
+void TimeParallelBiquad::setCoefficients(const Coefficients& newCoefficients)
+{
+    coefficients = newCoefficients;
+    
+    const auto& c = newCoefficients.coefficients;
+    const double b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+    
+    // s' = A s + B x,  y = C s + D x  with C = (1, 0) and D = b0
+    const double A[2][2] { { -a1, 1.0 }, { -a2, 0.0 } };
+    const double B[2] { b1 - a1 * b0, b2 - a2 * b0 };
+    
+    // Rows C A^k for k = 0 .. blockSize - 1
+    std::array<std::array<double, 2>, blockSize> outputRows;
+    outputRows[0] = { 1.0, 0.0 };
+    
+    for (size_t k = 1; k < blockSize; ++k)
+    {
+        const auto& r = outputRows[k - 1];
+        outputRows[k] = { r[0] * A[0][0] + r[1] * A[1][0], r[0] * A[0][1] + r[1] * A[1][1] };
+    }
+    
+    // Impulse response h[0] = D, h[m] = C A^(m - 1) B
+    std::array<double, blockSize> h;
+    h[0] = b0;
+    
+    for (size_t m = 1; m < blockSize; ++m)
+        h[m] = outputRows[m - 1][0] * B[0] + outputRows[m - 1][1] * B[1];
+    
+    // Columns A^m B for m = 0 .. blockSize - 1, and A^blockSize
+    std::array<std::array<double, 2>, blockSize> stateColumns;
+    stateColumns[0] = { B[0], B[1] };
+    
+    for (size_t m = 1; m < blockSize; ++m)
+    {
+        const auto& v = stateColumns[m - 1];
+        stateColumns[m] = { A[0][0] * v[0] + A[0][1] * v[1], A[1][0] * v[0] + A[1][1] * v[1] };
+    }
+    
+    double power[2][2] { { 1.0, 0.0 }, { 0.0, 1.0 } };
+    
+    for (size_t m = 0; m < blockSize; ++m)
+    {
+        double next[2][2];
+        
+        for (int i = 0; i < 2; ++i)
+            for (int j = 0; j < 2; ++j)
+                next[i][j] = A[i][0] * power[0][j] + A[i][1] * power[1][j];
+        
+        std::memcpy(power, next, sizeof(power));
+    }
+    
+    for (int i = 0; i < 2; ++i)
+    {
+        stateToOutput[i] = SIMDFloat::expand(0.f);
+        stateToState[i] = SIMDFloat::expand(0.f);
+        
+        for (size_t k = 0; k < blockSize; ++k)
+            stateToOutput[i].set(k, (float)outputRows[k][i]);
+        
+        // Column i of A^blockSize: where state element i ends up
+        stateToState[i].set(0, (float)power[0][i]);
+        stateToState[i].set(1, (float)power[1][i]);
+    }
+    
+    for (size_t j = 0; j < blockSize; ++j)
+    {
+        inputToOutput[j] = SIMDFloat::expand(0.f);
+        inputToState[j] = SIMDFloat::expand(0.f);
+        
+        for (size_t k = j; k < blockSize; ++k)
+            inputToOutput[j].set(k, (float)h[k - j]);
+        
+        const auto& v = stateColumns[blockSize - 1 - j];
+        inputToState[j].set(0, (float)v[0]);
+        inputToState[j].set(1, (float)v[1]);
+    }
+}
+
+void TimeParallelBiquad::process(float* data, size_t numSamples, float& state1, float& state2) const noexcept
+{
+    // Locals, so the state stays in registers rather than being written back through the
+    // references (which the compiler has to assume may alias data) every block
+    auto s1 = state1, s2 = state2;
+    alignas(SIMDFloat::SIMDRegisterSize) float outputs[blockSize];
+    size_t i = 0;
+    
+    for (; i + blockSize <= numSamples; i += blockSize)
+    {
+        // The input terms don't depend on the previous block, so they're summed first and only
+        // the two state terms are left on the block-to-block dependency chain
+        auto x = SIMDFloat::expand(data[i]);
+        auto y = inputToOutput[0] * x;
+        auto s = inputToState[0] * x;
+        
+        for (size_t j = 1; j < blockSize; ++j)
+        {
+            x = SIMDFloat::expand(data[i + j]);
+            y += inputToOutput[j] * x;
+            s += inputToState[j] * x;
+        }
+        
+        y += stateToOutput[0] * s1 + stateToOutput[1] * s2;
+        s += stateToState[0] * s1 + stateToState[1] * s2;
+        
+        // Channel pointers carry no alignment guarantee, so go through an aligned copy
+        y.copyToRawArray(outputs);
+        std::memcpy(data + i, outputs, sizeof(outputs));
+        
+        s1 = s.get(0);
+        s2 = s.get(1);
+    }
+    
+    // Whatever doesn't fill a whole block goes through the plain recursion
+    const auto& [b0, b1, b2, a1, a2] = coefficients.coefficients;
+    
+    for (; i < numSamples; ++i)
+    {
+        auto input = data[i];
+        auto output = input * b0 + s1;
+        data[i] = output;
+        
+        s1 = (input * b1) - (output * a1) + s2;
+        s2 = (input * b2) - (output * a2);
+    }
+    
+    state1 = s1;
+    state2 = s2;
+}
+#endif
+
+//==============================================================================
+ControlRateScheduler::ControlRateScheduler(juce::AudioProcessorValueTreeState& vts, const ParameterHandles& handles) :
+juce::Thread("SimpleEQ Coefficients"),
+apvts(vts),
+params(handles)
+{
+    for (auto* param : apvts.processor.getParameters())
+    {
+        if (auto* rap = dynamic_cast<juce::RangedAudioParameter*>(param))
+            apvts.addParameterListener(rap->paramID, this);
+    }
+}
+
+ControlRateScheduler::~ControlRateScheduler()
+{
+    release();
+    
+    for (auto* param : apvts.processor.getParameters())
+    {
+        if (auto* rap = dynamic_cast<juce::RangedAudioParameter*>(param))
+            apvts.removeParameterListener(rap->paramID, this);
+    }
+}
+
+int ControlRateScheduler::getControlInterval(int controlRateIndex)
+{
+    // "16 samples", "32 samples", "64 samples", "128 samples"
+    return 16 << juce::jlimit(0, 3, controlRateIndex);
+}
+
+void ControlRateScheduler::prepare(double newSampleRate)
+{
+    release();
+    
+    sampleRate = newSampleRate;
+    needsUpdate = false;
+    
+    // Ramps take 20 ms whatever the control rate
+    for (auto* smoother : { &lowCutFreq, &highCutFreq, &peakFreq, &peakQuality })
+        smoother->reset(sampleRate, 0.02);
+    peakGain.reset(sampleRate, 0.02);
+    
+    for (auto band : { ChainPositions::LowCut, ChainPositions::Peak, ChainPositions::HighCut })
+    {
+        seenBandVersions[band] = bandVersions[band].load();
+        readTargets(band);
+    }
+    
+    for (auto* smoother : { &lowCutFreq, &highCutFreq, &peakFreq, &peakQuality })
+        smoother->setCurrentAndTargetValue(smoother->getTargetValue());
+    peakGain.setCurrentAndTargetValue(peakGain.getTargetValue());
+    
+    for (auto band : { ChainPositions::LowCut, ChainPositions::Peak, ChainPositions::HighCut })
+        designBand(band);
+    
+    // Room for the longest ramp there can be, 20 ms at the fastest control rate, and its final step
+    CoefficientRamp initial;
+    initial.steps.resize((size_t)((int)(sampleRate * 0.02) / getControlInterval(0) + 2), latest);
+    initial.bands = (1 << ChainPositions::LowCut) | (1 << ChainPositions::Peak) | (1 << ChainPositions::HighCut);
+    ramps.reset(initial);
+    
+    rampStart = 0;
+    position = 0;
+    currentStep = 0;
+    playedSamples.store(0, std::memory_order_release);
+    
+    startThread();
+}
+
+void ControlRateScheduler::release()
+{
+    stopThread(1000);
+}
+
+void ControlRateScheduler::triggerUpdate()
+{
+    for (auto& version : bandVersions)
+        ++version;
+    
+    requestRamp();
+}
+
+void ControlRateScheduler::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // Route the change to the band owning the parameter, e.g. "Peak Gain" -> Peak
+    if (parameterID.startsWith("LowCut"))
+        ++bandVersions[ChainPositions::LowCut];
+    else if (parameterID.startsWith("Peak"))
+        ++bandVersions[ChainPositions::Peak];
+    else if (parameterID.startsWith("HighCut"))
+        ++bandVersions[ChainPositions::HighCut];
+    else
+        return;
+    
+    requestRamp();
+}
+
+void ControlRateScheduler::requestRamp()
+{
+    needsUpdate = true;
+    
+    // Signalling the thread takes a lock, so only wake it directly from the message thread.
+    // Changes coming from the audio thread (host automation) are picked up by polling in run()
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        notify();
+}
+
+void ControlRateScheduler::run()
+{
+    while (! threadShouldExit())
+    {
+        if (needsUpdate.exchange(false))
+            publishRamp();
+        
+        // Short enough that polled changes start well inside the 20 ms ramp
+        wait(2);
+    }
+}
+
+int ControlRateScheduler::advance()
+{
+    if (ramps.acquire())
+        currentStep = -1;
+    
+    // The designer starts a ramp at a position we had already reached, so any steps it has
+    // for the time since then are skipped
+    const auto& ramp = ramps.getReadBuffer();
+    auto elapsed = position - juce::jmin(position, ramp.startSample);
+    auto step = (int)juce::jmin((juce::uint64)(ramp.numSteps - 1), elapsed / (juce::uint64)ramp.interval);
+    
+    if (step == currentStep)
+        return 0;
+    
+    currentStep = step;
+    return ramp.bands;
+}
+
+void ControlRateScheduler::samplesProcessed(int numSamples)
+{
+    position += (juce::uint64)numSamples;
+    playedSamples.store(position, std::memory_order_release);
+}
+
+void ControlRateScheduler::publishRamp()
+{
+    // Bring the smoothers from the start of the last ramp up to where the audio thread is now,
+    // which is where the new ramp starts from
+    auto now = playedSamples.load(std::memory_order_acquire);
+    auto elapsed = (int)juce::jmin(now - rampStart, (juce::uint64)std::numeric_limits<int>::max());
+    
+    auto skip = [this](int numSamples)
+    {
+        for (auto* smoother : { &lowCutFreq, &highCutFreq, &peakFreq, &peakQuality })
+            smoother->skip(numSamples);
+        peakGain.skip(numSamples);
+    };
+    
+    skip(elapsed);
+    rampStart = now;
+    
+    // Pick up new targets for the bands whose parameters changed
+    int bands = 0;
+    
+    for (auto band : { ChainPositions::LowCut, ChainPositions::Peak, ChainPositions::HighCut })
+    {
+        auto version = bandVersions[band].load();
+        
+        if (version != seenBandVersions[band])
+        {
+            seenBandVersions[band] = version;
+            readTargets(band);
+            bands |= 1 << band;
+        }
+    }
+    
+    // Bands still on their way to earlier targets carry on in the new ramp
+    if (lowCutFreq.isSmoothing())
+        bands |= 1 << ChainPositions::LowCut;
+    
+    if (peakFreq.isSmoothing() || peakGain.isSmoothing() || peakQuality.isSmoothing())
+        bands |= 1 << ChainPositions::Peak;
+    
+    if (highCutFreq.isSmoothing())
+        bands |= 1 << ChainPositions::HighCut;
+    
+    if (bands == 0)
+        return;
+    
+    auto& ramp = ramps.getWriteBuffer();
+    ramp.startSample = now;
+    ramp.interval = getControlInterval((int)params.get(Param_ControlRate));
+    ramp.bands = bands;
+    ramp.numSteps = 0;
+    
+    // Step through the ramp on copies, so the smoothers stay at its start for the next change
+    auto smoothers = std::make_tuple(lowCutFreq, highCutFreq, peakFreq, peakQuality, peakGain);
+    auto isSmoothing = [this]
+    {
+        return lowCutFreq.isSmoothing() || highCutFreq.isSmoothing() || peakFreq.isSmoothing()
+            || peakQuality.isSmoothing() || peakGain.isSmoothing();
+    };
+    
+    do
+    {
+        // The last slot always gets the targets, should a ramp ever be longer than prepare() allowed for
+        skip(ramp.numSteps + 1 < (int)ramp.steps.size() ? ramp.interval : std::numeric_limits<int>::max());
+        
+        for (auto band : { ChainPositions::LowCut, ChainPositions::Peak, ChainPositions::HighCut })
+        {
+            if (bands & (1 << band))
+                designBand(band);
+        }
+        
+        ramp.steps[(size_t)ramp.numSteps++] = latest;
+    }
+    while (isSmoothing());
+    
+    std::tie(lowCutFreq, highCutFreq, peakFreq, peakQuality, peakGain) = smoothers;
+    ramps.publish();
+}
+
+void ControlRateScheduler::readTargets(ChainPositions band)
+{
+    auto& settings = latest.settings;
+    
+    // Slopes and bypass switches take effect at the ramp's first step; the processor crossfades them
+    switch (band)
+    {
+        case ChainPositions::LowCut:
+        {
+            lowCutFreq.setTargetValue(params.get(Param_LowCutFreq));
+            settings.lowCutSlope = static_cast<Slope>(params.get(Param_LowCutSlope));
+            settings.lowCutBypassed = params.get(Param_LowCutBypassed) > 0.5f;
+            break;
+        }
+        case ChainPositions::Peak:
+        {
+            peakFreq.setTargetValue(params.get(Param_PeakFreq));
+            peakGain.setTargetValue(params.get(Param_PeakGain));
+            peakQuality.setTargetValue(params.get(Param_PeakQuality));
+            settings.peakBypassed = params.get(Param_PeakBypassed) > 0.5f;
+            break;
+        }
+        case ChainPositions::HighCut:
+        {
+            highCutFreq.setTargetValue(params.get(Param_HighCutFreq));
+            settings.highCutSlope = static_cast<Slope>(params.get(Param_HighCutSlope));
+            settings.highCutBypassed = params.get(Param_HighCutBypassed) > 0.5f;
+            break;
+        }
+    }
+}
+
+void ControlRateScheduler::designBand(ChainPositions band)
+{
+    auto& settings = latest.settings;
+    
+    switch (band)
+    {
+        case ChainPositions::LowCut:
+        {
+            settings.lowCutFreq = lowCutFreq.getCurrentValue();
+            latest.lowCut = makeLowCutFilter(settings, sampleRate);
+            break;
+        }
+        case ChainPositions::Peak:
+        {
+            settings.peakFreq = peakFreq.getCurrentValue();
+            settings.peakGainInDecibels = peakGain.getCurrentValue();
+            settings.peakQuality = peakQuality.getCurrentValue();
+            updateCoefficients(latest.peak, makePeakFilter(settings, sampleRate));
+            break;
+        }
+        case ChainPositions::HighCut:
+        {
+            settings.highCutFreq = highCutFreq.getCurrentValue();
+            latest.highCut = makeHighCutFilter(settings, sampleRate);
+            break;
+        }
+    }
+}
+
+const char* LoadMeter::getStageName(Stage stage)
+{
+    static constexpr std::array<const char*, Stage_NumStages> names
+    {
+        "parameters",
+        "coefficients",
+        "dsp",
+        "analyzer"
+    };
+    
+    return names[stage];
+}
+
+void LoadMeter::prepare(double newSampleRate)
+{
+    // getSnapshot() may be reading on the message thread. The generation is odd while we clear,
+    // and different afterwards, so a snapshot that overlapped the reset is taken again
+    auto resetGeneration = generation.load(std::memory_order_relaxed);
+    generation.store(resetGeneration + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    sampleRate.store(newSampleRate, std::memory_order_relaxed);
+    secondsPerTick = 1.0 / (double)juce::Time::getHighResolutionTicksPerSecond();
+    
+    numBlocks.store(0, std::memory_order_relaxed);
+    budgetSeconds.store(0, std::memory_order_relaxed);
+    lastLoad.store(0.f, std::memory_order_relaxed);
+    peakLoad.store(0.f, std::memory_order_relaxed);
+    worstLoad.store(0.f, std::memory_order_relaxed);
+    numWorstBlocksWritten.store(0, std::memory_order_relaxed);
+    
+    for (auto& bin : histogram)
+        bin.store(0, std::memory_order_relaxed);
+    
+    for (auto& seconds : stageSeconds)
+        seconds.store(0, std::memory_order_relaxed);
+    
+    // The worst-block slots keep their sequence numbers counting up, so a reader that started on
+    // a slot before the reset can't mistake it for one that didn't change
+    generation.store(resetGeneration + 2, std::memory_order_release);
+}
+
+void LoadMeter::endBlock(const BlockTimer& timer, int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+    
+    auto budget = (double)numSamples / sampleRate.load(std::memory_order_relaxed);
+    std::array<float, Stage_NumStages> stageLoads;
+    float load = 0.f;
+    
+    for (int stage = 0; stage < Stage_NumStages; ++stage)
+    {
+        auto seconds = (double)timer.ticks[stage] * secondsPerTick;
+        add(stageSeconds[stage], seconds);
+        stageLoads[stage] = (float)(seconds / budget);
+        load += stageLoads[stage];
+    }
+    
+    auto blockIndex = numBlocks.load(std::memory_order_relaxed);
+    add(numBlocks, (juce::uint64)1);
+    add(budgetSeconds, budget);
+    add(histogram[(size_t)juce::jmin(numBins - 1, (int)(load / binWidth))], (juce::uint32)1);
+    
+    lastLoad.store(load, std::memory_order_relaxed);
+    
+    // The message thread resets the peak, so this one has to be a compare-and-swap
+    auto peak = peakLoad.load(std::memory_order_relaxed);
+    while (load > peak && ! peakLoad.compare_exchange_weak(peak, load, std::memory_order_relaxed)) {}
+    
+    if (load < spikeThreshold && load <= worstLoad.load(std::memory_order_relaxed))
+        return;
+    
+    if (load > worstLoad.load(std::memory_order_relaxed))
+        worstLoad.store(load, std::memory_order_relaxed);
+    
+    auto written = numWorstBlocksWritten.load(std::memory_order_relaxed);
+    auto& slot = worstBlocks[(size_t)(written % numWorstBlocks)];
+    auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    slot.blockIndex.store(blockIndex, std::memory_order_relaxed);
+    slot.numSamples.store(numSamples, std::memory_order_relaxed);
+    slot.load.store(load, std::memory_order_relaxed);
+    
+    for (int stage = 0; stage < Stage_NumStages; ++stage)
+        slot.stageLoads[stage].store(stageLoads[stage], std::memory_order_relaxed);
+    
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    numWorstBlocksWritten.store(written + 1, std::memory_order_release);
+}
+
+LoadMeter::Snapshot LoadMeter::getSnapshot() const
+{
+    // A snapshot that overlaps a reset in prepare() is taken again, and given up on (left empty)
+    // if that keeps happening
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        auto before = generation.load(std::memory_order_acquire);
+        
+        if ((before & 1) != 0)
+            continue;
+        
+        auto snapshot = readSnapshot();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        
+        if (generation.load(std::memory_order_relaxed) == before)
+            return snapshot;
+    }
+    
+    return {};
+}
+
+LoadMeter::Snapshot LoadMeter::readSnapshot() const
 {
-    auto cutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
+    Snapshot snapshot;
+    snapshot.sampleRate = sampleRate.load(std::memory_order_relaxed);
+    snapshot.numBlocks = numBlocks.load(std::memory_order_relaxed);
+    snapshot.budgetSeconds = budgetSeconds.load(std::memory_order_relaxed);
+    snapshot.worstLoad = worstLoad.load(std::memory_order_relaxed);
     
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    for (int bin = 0; bin < numBins; ++bin)
+        snapshot.histogram[bin] = histogram[bin].load(std::memory_order_relaxed);
     
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    for (int stage = 0; stage < Stage_NumStages; ++stage)
+        snapshot.stageSeconds[stage] = stageSeconds[stage].load(std::memory_order_relaxed);
     
-    updateCutFilter(leftLowCut, cutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, cutCoefficients, chainSettings.lowCutSlope);
+    auto written = numWorstBlocksWritten.load(std::memory_order_acquire);
+    auto first = written > numWorstBlocks ? written - numWorstBlocks : 0;
+    
+    for (auto index = first; index < written; ++index)
+    {
+        const auto& slot = worstBlocks[(size_t)(index % numWorstBlocks)];
+        
+        // A slot the audio thread keeps overwriting is skipped rather than waited for
+        for (int attempt = 0; attempt < 4; ++attempt)
+        {
+            auto before = slot.sequence.load(std::memory_order_acquire);
+            
+            if ((before & 1) != 0)
+                continue;
+            
+            WorstBlock block;
+            block.blockIndex = slot.blockIndex.load(std::memory_order_relaxed);
+            block.numSamples = slot.numSamples.load(std::memory_order_relaxed);
+            block.load = slot.load.load(std::memory_order_relaxed);
+            
+            for (int stage = 0; stage < Stage_NumStages; ++stage)
+                block.stageLoads[stage] = slot.stageLoads[stage].load(std::memory_order_relaxed);
+            
+            std::atomic_thread_fence(std::memory_order_acquire);
+            
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+            {
+                snapshot.worstBlocks.push_back(block);
+                break;
+            }
+        }
+    }
+    
+    return snapshot;
 }
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings)
+float LoadMeter::Snapshot::getPercentile(float fraction) const
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
+    juce::uint64 total = 0;
+    for (auto count : histogram)
+        total += count;
     
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+    if (total == 0)
+        return 0.f;
     
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    auto target = juce::jmax((juce::uint64)1, (juce::uint64)std::llround((double)fraction * (double)total));
+    juce::uint64 counted = 0;
     
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        counted += histogram[bin];
+        
+        if (counted >= target)
+            return (float)(bin + 1) * binWidth;
+    }
+    
+    return (float)numBins * binWidth;
 }
 
-void SimpleEQAudioProcessor::updateFilters()
+juce::String LoadMeter::Snapshot::toString() const
 {
-    auto chainSettings = getChainSettings(apvts);
+    juce::String text;
+    text << "simpleEQ load snapshot, " << juce::Time::getCurrentTime().toISO8601(true) << "\n"
+         << "sample rate: " << sampleRate << " Hz, blocks: " << (juce::int64)numBlocks << "\n";
+    
+    if (budgetSeconds > 0)
+    {
+        double totalSeconds = 0;
+        for (auto seconds : stageSeconds)
+            totalSeconds += seconds;
+        
+        text << "mean load: " << juce::String(100.0 * totalSeconds / budgetSeconds, 2) << "%";
+        
+        for (int stage = 0; stage < Stage_NumStages; ++stage)
+            text << ", " << getStageName(static_cast<Stage>(stage)) << " " << juce::String(100.0 * stageSeconds[stage] / budgetSeconds, 2) << "%";
+        
+        text << "\n";
+    }
+    
+    text << "p50 <= " << juce::roundToInt(100.f * getPercentile(0.5f)) << "%, "
+         << "p99 <= " << juce::roundToInt(100.f * getPercentile(0.99f)) << "%, "
+         << "worst " << juce::String(100.f * worstLoad, 1) << "%\n\n";
+    
+    text << "histogram (% of budget: blocks)\n";
+    
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        if (histogram[bin] == 0)
+            continue;
+        
+        auto from = juce::roundToInt(100.f * (float)bin * binWidth);
+        text << "  " << from << (bin == numBins - 1 ? "+" : "-" + juce::String(from + juce::roundToInt(100.f * binWidth))) << ": " << (int)histogram[bin] << "\n";
+    }
+    
+    text << "\nworst blocks, oldest first (block, samples, load";
+    for (int stage = 0; stage < Stage_NumStages; ++stage)
+        text << ", " << getStageName(static_cast<Stage>(stage));
+    text << ")\n";
     
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    for (const auto& block : worstBlocks)
+    {
+        text << "  " << (juce::int64)block.blockIndex << ", " << block.numSamples << ", " << juce::String(100.f * block.load, 1) << "%";
+        
+        for (auto stageLoad : block.stageLoads)
+            text << ", " << juce::String(100.f * stageLoad, 1) << "%";
+        
+        text << "\n";
+    }
+    
+    return text;
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout()
@@ -350,6 +1389,30 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::crea
     layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{"HighCut Bypassed", 1}, "HighCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{"Analyzer Enabled", 1}, "Analyzer Enabled", false));
     
+    // How often automation is picked up and coefficients are redesigned, in samples.
+    // A setting rather than something to automate
+    juce::StringArray controlRates { "16 samples", "32 samples", "64 samples", "128 samples" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"Control Rate", 1}, "Control Rate", controlRates, 1, juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    
+    // How far consecutive analyzer FFT frames overlap. Display only, so not automatable either
+    juce::StringArray analyzerOverlaps { "0% overlap", "50% overlap", "75% overlap", "87.5% overlap" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"Analyzer Overlap", 1}, "Analyzer Overlap", analyzerOverlaps, 1, juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    
+    // Analyzer FFT size. Auto picks one from the sample rate
+    juce::StringArray analyzerResolutions { "Auto", "2048 points", "4096 points", "8192 points" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"Analyzer Resolution", 1}, "Analyzer Resolution", analyzerResolutions, 0, juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    
+    // Averaging time constant and peak-hold decay for the analyzer display
+    juce::StringArray analyzerAveragings { "No averaging", "100 ms average", "300 ms average", "1 s average" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"Analyzer Averaging", 1}, "Analyzer Averaging", analyzerAveragings, 0, juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    
+    juce::StringArray analyzerPeakHolds { "No peak hold", "Peak hold 3 dB/s", "Peak hold 12 dB/s" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"Analyzer Peak Hold", 1}, "Analyzer Peak Hold", analyzerPeakHolds, 0, juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    
+    // Fractional-octave smoothing of the analyzer spectrum
+    juce::StringArray analyzerSmoothings { "No smoothing", "1/3 octave", "1/6 octave", "1/12 octave" };
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"Analyzer Smoothing", 1}, "Analyzer Smoothing", analyzerSmoothings, 0, juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    
     return layout;
 }
 
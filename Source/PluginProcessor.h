@@ -11,6 +11,18 @@
 #include <JuceHeader.h>
 
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// When set, channel groups holding a single channel (mono, or a leftover channel) are filtered by
+// TimeParallelBiquad instead of the lane-interleaved cascade. Set it to 0 in the exporter's
+// preprocessor definitions to build with the interleaved path only
+#ifndef SIMPLEEQ_TIME_PARALLEL_IIR
+ #define SIMPLEEQ_TIME_PARALLEL_IIR 1
+#endif
+
 template<typename T>
 struct Fifo
 {
@@ -68,68 +80,141 @@ private:
     juce::AbstractFifo fifo {Capacity};
 };
 
-enum Channel
+// The analyzer's tap on the processed audio: one planar float ring per side, a power of two long
+// so wrapping is a mask. The audio thread copies a whole host block in with at most two memcpys
+// per side and never allocates; the editor takes everything new in one go.
+// Single producer, single consumer: both positions only ever grow and each side only writes its own.
+// When the reader falls behind, e.g. while the editor is closed, new blocks are dropped rather than
+// overwriting audio it hasn't read
+struct StereoCaptureRing
 {
-    Right, // effectively 0
-    Left   // effectively 1
+    // Big enough for the largest FFT plus a few host blocks of slack. Fixed, so the reader never
+    // has to worry about the storage moving under it
+    static constexpr int capacity = 1 << 15;
+    
+    StereoCaptureRing() : left((size_t)capacity, 0.f), right((size_t)capacity, 0.f) { }
+    
+    // Audio thread. A mono bus feeds its only channel to both sides.
+    // Of a block longer than the whole ring only the end is kept
+    void push(const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        if (buffer.getNumChannels() == 0 || buffer.getNumSamples() == 0)
+            return;
+        
+        auto skip = juce::jmax(0, buffer.getNumSamples() - capacity);
+        auto numSamples = buffer.getNumSamples() - skip;
+        auto write = writePosition.load(std::memory_order_relaxed);
+        auto read = readPosition.load(std::memory_order_acquire);
+        
+        if (numSamples > capacity - (int)(write - read))
+            return;
+        
+        copyIn(left, buffer.getReadPointer(0, skip), write, numSamples);
+        copyIn(right, buffer.getReadPointer(juce::jmin(1, buffer.getNumChannels() - 1), skip), write, numSamples);
+        
+        writePosition.store(write + (juce::uint64)numSamples, std::memory_order_release);
+    }
+    
+    // Reader. How many samples pull() can return
+    int getNumReady() const noexcept
+    {
+        return (int)(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_relaxed));
+    }
+    
+    // Reader. Copies out up to maxSamples of the oldest unread audio and returns how many it copied
+    int pull(float* leftOut, float* rightOut, int maxSamples) noexcept
+    {
+        auto read = readPosition.load(std::memory_order_relaxed);
+        auto numSamples = juce::jmin(maxSamples, getNumReady());
+        
+        copyOut(left, leftOut, read, numSamples);
+        copyOut(right, rightOut, read, numSamples);
+        
+        readPosition.store(read + (juce::uint64)numSamples, std::memory_order_release);
+        return numSamples;
+    }
+    
+    // Reader. Drops all but the newest numSamples unread samples, e.g. the stale audio left over
+    // from before the editor was opened
+    void skipToLatest(int numSamples) noexcept
+    {
+        auto ready = getNumReady();
+        
+        if (ready > numSamples)
+            readPosition.store(readPosition.load(std::memory_order_relaxed) + (juce::uint64)(ready - numSamples), std::memory_order_release);
+    }
+    
+private:
+    static constexpr juce::uint64 mask = (juce::uint64)capacity - 1;
+    
+    static void copyIn(std::vector<float>& ring, const float* source, juce::uint64 position, int numSamples) noexcept
+    {
+        auto start = (int)(position & mask);
+        auto first = juce::jmin(numSamples, capacity - start);
+        
+        std::memcpy(ring.data() + start, source, sizeof(float) * (size_t)first);
+        std::memcpy(ring.data(), source + first, sizeof(float) * (size_t)(numSamples - first));
+    }
+    
+    static void copyOut(const std::vector<float>& ring, float* destination, juce::uint64 position, int numSamples) noexcept
+    {
+        auto start = (int)(position & mask);
+        auto first = juce::jmin(numSamples, capacity - start);
+        
+        std::memcpy(destination, ring.data() + start, sizeof(float) * (size_t)first);
+        std::memcpy(destination + first, ring.data(), sizeof(float) * (size_t)(numSamples - first));
+    }
+    
+    std::vector<float> left, right;
+    std::atomic<juce::uint64> writePosition { 0 }, readPosition { 0 };
 };
 
-template<typename BlockType>
-struct SingleChannelSampleFifo
+// Lock-free single-producer/single-consumer triple buffer.
+// The writer fills getWriteBuffer() and calls publish(), the reader calls acquire()
+// and reads getReadBuffer(). The middle slot is swapped with a single atomic exchange,
+// so neither side ever blocks, and the slot being read is never the one being written.
+template<typename T>
+struct TripleBuffer
 {
-    SingleChannelSampleFifo(Channel ch) : channelToUse(ch)
+    // Writer side
+    T& getWriteBuffer() { return buffers[writeIndex]; }
+    
+    void publish()
     {
-        prepared.set(false);
+        writeIndex = middle.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel) & indexMask;
     }
     
-    void update(const BlockType& buffer)
+    // Reader side. Returns true if a new buffer has been published since the last call
+    bool acquire()
     {
-        jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
+        if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+            return false;
         
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            pushNextSampleIntoFifo(channelPtr[i]);
-        }
-    }
-    void prepare(int bufferSize)
-    {
-        prepared.set(false);
-        size.set(bufferSize);
-        bufferToFill.setSize(1, bufferSize, false, true, true);
-        audioBufferFifo.prepare(1, bufferSize);
-        fifoIndex = 0;
-        prepared.set(true);
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
     }
     
-    int getNumCompleteBuffersAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
-    bool isPrepared() const { return prepared.get(); }
-    int getSize() const { return size.get(); }
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
-    
-private:
-    Channel channelToUse;
-    int fifoIndex = 0;
-    Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
-    juce::Atomic<bool> prepared = false;
-    juce::Atomic<int> size = 0;
+    T& getReadBuffer() { return buffers[readIndex]; }
+    const T& getReadBuffer() const { return buffers[readIndex]; }
     
-    void pushNextSampleIntoFifo(float sample)
+    // Neither side may be running: puts a copy of initial in every slot and forgets anything published
+    void reset(const T& initial)
     {
-        if (fifoIndex == bufferToFill.getNumSamples())
-        {
-            auto ok = audioBufferFifo.push(bufferToFill);
-            juce::ignoreUnused(ok);
-            fifoIndex = 0;
-        }
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
+        buffers.fill(initial);
+        writeIndex = 0;
+        readIndex = 1;
+        middle.store(2, std::memory_order_release);
     }
+    
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+    
+    std::array<T, 3> buffers;
+    int writeIndex = 0, readIndex = 1;
+    std::atomic<int> middle { 2 };
 };
 
-// enum declaration for slope parameter
 enum Slope
 {
     Slope_12,
@@ -147,12 +232,55 @@ struct ChainSettings
     bool lowCutBypassed { false }, peakBypassed { false }, highCutBypassed { false };
 };
 
+// Every parameter in createParameterLayout(), used to index ParameterHandles
+enum Params
+{
+    Param_LowCutFreq,
+    Param_HighCutFreq,
+    Param_PeakFreq,
+    Param_PeakGain,
+    Param_PeakQuality,
+    Param_LowCutSlope,
+    Param_HighCutSlope,
+    Param_LowCutBypassed,
+    Param_PeakBypassed,
+    Param_HighCutBypassed,
+    Param_AnalyzerEnabled,
+    Param_ControlRate,
+    Param_AnalyzerOverlap,
+    Param_AnalyzerResolution,
+    Param_AnalyzerAveraging,
+    Param_AnalyzerPeakHold,
+    Param_AnalyzerSmoothing,
+    
+    Param_NumParams
+};
+
+// Parameter IDs in the same order as the Params enum
+const char* getParameterID(Params param);
+
+// Raw parameter values resolved once by ID, so reading a parameter is a single relaxed atomic load
+struct ParameterHandles
+{
+    explicit ParameterHandles(juce::AudioProcessorValueTreeState& apvts);
+    
+    float get(Params param) const { return values[param]->load(std::memory_order_relaxed); }
+    
+private:
+    std::array<std::atomic<float>*, Param_NumParams> values;
+};
+
 // Helper function to give us these parameter values in our struct
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+ChainSettings getChainSettings(const ParameterHandles& params);
 
-using Filter = juce::dsp::IIR::Filter<float>;
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+// Plain biquad coefficients, normalised so a0 == 1 and laid out as { b0, b1, b2, a1, a2 }.
+// Being a POD it can be designed, copied and published from any thread without touching the heap
+struct BiquadCoefficients
+{
+    std::array<float, 5> coefficients { 1.f, 0.f, 0.f, 0.f, 0.f };
+    
+    double getMagnitudeForFrequency(double frequency, double sampleRate) const noexcept;
+};
 
 enum ChainPositions
 {
@@ -161,62 +289,581 @@ enum ChainPositions
     HighCut
 };
 
-using Coefficients = Filter::CoefficientsPtr;
+// True when the band can be left out of the chain entirely: it's bypassed, the peak sits at 0 dB,
+// or a cut sits at the end of its range (20 Hz low cut, 20 kHz high cut), where we treat it as off
+bool isBandIdentity(const ChainSettings& chainSettings, ChainPositions band);
+
+// True when going from one set of settings to the other switches filter sections in or out
+bool changesActiveSections(const ChainSettings& from, const ChainSettings& to);
+
+using Coefficients = BiquadCoefficients;
+using CutCoefficients = std::array<Coefficients, 4>;
 void updateCoefficients(Coefficients& old, const Coefficients& replacements);
 
 Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
 
-template<int Index, typename ChainType, typename CoefficientType>
-void update(ChainType& chain, const CoefficientType& coefficients)
+// Closed form Butterworth design for even orders 2..8: writes order / 2 biquad sections
+// into `sections` and returns how many it wrote. Nothing is allocated, so it's safe on any thread
+int designButterworthCut(CutCoefficients& sections, bool isHighPass, float frequency, double sampleRate, int order);
+
+// Need helper functions for producing cut coefficients
+// If we want to implement these functions in header files that are included
+// in multiple locations (like our plugin processor is included in PluginProcessor.cpp
+// and .h and PluginEditor.cpp and .h) we need to use the inline keyword, otherwise compiler
+// will produce a definition for this function each place the header file is included,
+//and the linker will not know which compiled .cpp file to use for the definition
+inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    CutCoefficients sections;
+    designButterworthCut(sections, true, chainSettings.lowCutFreq, sampleRate, 2 * (chainSettings.lowCutSlope + 1));
+    return sections;
+}
+
+inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    CutCoefficients sections;
+    designButterworthCut(sections, false, chainSettings.highCutFreq, sampleRate, 2 * (chainSettings.highCutSlope + 1));
+    return sections;
+}
+
+//==============================================================================
+// One section's coefficients in the sample type a cascade runs on: float for a
+// single channel, juce::dsp::SIMDRegister<float> with the value broadcast to every lane
+template<typename SampleType>
+using SectionCoefficients = std::array<SampleType, 5>;
+
+template<typename SampleType>
+SampleType broadcast(float value)
 {
-    updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
-    chain.template setBypassed<Index>(false);
+    if constexpr (std::is_same_v<SampleType, float>)
+        return value;
+    else
+        return SampleType::expand(value);
 }
 
-template<typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType& chain, const CoefficientType& coefficients, const Slope& slope)
+// One sample through one transposed direct form II section
+template<typename SampleType>
+inline SampleType processBiquadSample(SampleType input, const SectionCoefficients<SampleType>& c, SampleType& lv1, SampleType& lv2) noexcept
+{
+    auto output = input * c[0] + lv1;
+    lv1 = (input * c[1]) - (output * c[3]) + lv2;
+    lv2 = (input * c[2]) - (output * c[4]);
+    return output;
+}
+
+// Runs exactly sizeof...(Sections) sections over the data in a single pass. Each sample goes
+// through the whole cascade before the next one is loaded, and the section states live in
+// locals, so they stay in registers for the whole loop. coefficients, s1 and s2 are packed:
+// entry k belongs to the k-th active section
+template<typename SampleType, size_t... Sections>
+void processFusedCascade(SampleType* data, size_t numSamples,
+                         const SectionCoefficients<SampleType>* coefficients,
+                         SampleType* s1, SampleType* s2,
+                         std::index_sequence<Sections...>) noexcept
+{
+    if constexpr (sizeof...(Sections) > 0)
+    {
+        std::array<SampleType, sizeof...(Sections)> lv1 { s1[Sections]... };
+        std::array<SampleType, sizeof...(Sections)> lv2 { s2[Sections]... };
+        
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto x = data[i];
+            ((x = processBiquadSample(x, coefficients[Sections], lv1[Sections], lv2[Sections])), ...);
+            data[i] = x;
+        }
+        
+        ((s1[Sections] = lv1[Sections]), ...);
+        ((s2[Sections] = lv2[Sections]), ...);
+    }
+    else
+    {
+        juce::ignoreUnused(data, numSamples, coefficients, s1, s2);
+    }
+}
+
+template<typename SampleType>
+using CascadeKernel = void (*)(SampleType*, size_t, const SectionCoefficients<SampleType>*, SampleType*, SampleType*) noexcept;
+
+template<typename SampleType, int NumSections>
+void processCascade(SampleType* data, size_t numSamples, const SectionCoefficients<SampleType>* coefficients, SampleType* s1, SampleType* s2) noexcept
 {
-    chain.template setBypassed<0>(true);
-    chain.template setBypassed<1>(true);
-    chain.template setBypassed<2>(true);
-    chain.template setBypassed<3>(true);
+    processFusedCascade(data, numSamples, coefficients, s1, s2, std::make_index_sequence<NumSections>());
+}
+
+template<typename SampleType, size_t... NumSections>
+constexpr auto makeCascadeKernels(std::index_sequence<NumSections...>)
+{
+    return std::array<CascadeKernel<SampleType>, sizeof...(NumSections)> { &processCascade<SampleType, (int)NumSections>... };
+}
+
+// Dispatch table of fused kernels, indexed by the number of active sections (0 to MaxSections)
+template<typename SampleType, int MaxSections>
+inline constexpr auto cascadeKernels = makeCascadeKernels<SampleType>(std::make_index_sequence<MaxSections + 1>());
+
+// A cascade of up to MaxSections biquads. Only the active sections are packed together and run,
+// by the one fused kernel compiled for that many sections, so the per-sample cost scales exactly
+// with the number of active sections and there are no per-section bypass checks in the loop.
+// The filter state is kept outside, per section slot, so one cascade can drive several States
+// (e.g. one per SIMD lane group)
+template<typename SampleType, int MaxSections>
+struct BiquadCascade
+{
+    struct State
+    {
+        std::array<SampleType, MaxSections> s1, s2;
+        
+        void reset() { s1.fill(broadcast<SampleType>(0.f)); s2.fill(broadcast<SampleType>(0.f)); }
+        void resetSection(int slot) { s1[slot] = s2[slot] = broadcast<SampleType>(0.f); }
+    };
+    
+    // Returns true if the section has just been switched on, so its state should be cleared
+    bool setSection(int slot, const Coefficients& coefficients, bool active)
+    {
+        auto switchedOn = active && ! sectionActive[slot];
+        
+        sectionCoefficients[slot] = coefficients;
+        sectionActive[slot] = active;
+        pack();
+        
+        return switchedOn;
+    }
+    
+    bool isActive(int slot) const { return sectionActive[slot]; }
+    
+    int getActiveSectionMask() const
+    {
+        int mask = 0;
+        for (int slot = 0; slot < MaxSections; ++slot)
+            mask |= sectionActive[slot] ? (1 << slot) : 0;
+        return mask;
+    }
     
-    switch ( slope )
+    const Coefficients& getCoefficients(int slot) const { return sectionCoefficients[slot]; }
+    int getNumActiveSections() const { return numActive; }
+    
+    void process(SampleType* data, size_t numSamples, State& state) const noexcept
     {
-        case Slope_48:
+        // Gather the active sections' state, run the fused kernel, scatter it back
+        std::array<SampleType, MaxSections> s1, s2;
+        for (int k = 0; k < numActive; ++k)
         {
-            update<3>(chain, coefficients);
+            s1[k] = state.s1[packedSlots[k]];
+            s2[k] = state.s2[packedSlots[k]];
         }
-        case Slope_36:
+        
+        cascadeKernels<SampleType, MaxSections>[numActive](data, numSamples, packedCoefficients.data(), s1.data(), s2.data());
+        
+        for (int k = 0; k < numActive; ++k)
         {
-            update<2>(chain, coefficients);
+            state.s1[packedSlots[k]] = s1[k];
+            state.s2[packedSlots[k]] = s2[k];
         }
-        case Slope_24:
+    }
+    
+private:
+    void pack()
+    {
+        numActive = 0;
+        
+        for (int slot = 0; slot < MaxSections; ++slot)
         {
-            update<1>(chain, coefficients);
+            if (! sectionActive[slot])
+                continue;
+            
+            for (size_t i = 0; i < 5; ++i)
+                packedCoefficients[numActive][i] = broadcast<SampleType>(sectionCoefficients[slot].coefficients[i]);
+            
+            packedSlots[numActive] = slot;
+            ++numActive;
         }
-        case Slope_12:
+    }
+    
+    std::array<Coefficients, MaxSections> sectionCoefficients;
+    std::array<bool, MaxSections> sectionActive {};
+    
+    std::array<SectionCoefficients<SampleType>, MaxSections> packedCoefficients;
+    std::array<int, MaxSections> packedSlots {};
+    int numActive = 0;
+};
+
+// The full EQ as one 9-section cascade: 4 low cut sections, the peak, 4 high cut sections
+template<typename SampleType>
+struct ChainCascade : BiquadCascade<SampleType, 9>
+{
+    static constexpr int numSections = 9;
+    static constexpr int lowCutStart = 0, peakIndex = 4, highCutStart = 5;
+    // Section slots of each band, as bitmasks
+    static constexpr int lowCutSections = 0xf << lowCutStart, peakSections = 1 << peakIndex, highCutSections = 0xf << highCutStart;
+    
+    // Each returns a bitmask of section slots that have just been switched on
+    int setLowCut(const CutCoefficients& coefficients, Slope slope, bool bypassed)
+    {
+        return setCut(lowCutStart, coefficients, slope, bypassed);
+    }
+    
+    int setPeak(const Coefficients& coefficients, bool bypassed)
+    {
+        return this->setSection(peakIndex, coefficients, ! bypassed) ? (1 << peakIndex) : 0;
+    }
+    
+    int setHighCut(const CutCoefficients& coefficients, Slope slope, bool bypassed)
+    {
+        return setCut(highCutStart, coefficients, slope, bypassed);
+    }
+    
+    // Combined magnitude response of every active section
+    double getMagnitudeForFrequency(double frequency, double sampleRate) const noexcept
+    {
+        double magnitude = 1.0;
+        
+        for (int slot = 0; slot < numSections; ++slot)
         {
-            update<0>(chain, coefficients);
+            if (this->isActive(slot))
+                magnitude *= this->getCoefficients(slot).getMagnitudeForFrequency(frequency, sampleRate);
         }
+        
+        return magnitude;
     }
-}
+    
+private:
+    int setCut(int start, const CutCoefficients& coefficients, Slope slope, bool bypassed)
+    {
+        // A slope of Slope_N uses the first N + 1 sections
+        int switchedOn = 0;
+        
+        for (int i = 0; i < (int)coefficients.size(); ++i)
+        {
+            if (this->setSection(start + i, coefficients[i], ! bypassed && i <= slope))
+                switchedOn |= 1 << (start + i);
+        }
+        
+        return switchedOn;
+    }
+};
 
-// Need helper functions for producing cut coefficients
-// If we want to implement these functions in header files that are included
-// in multiple locations (like our plugin processor is included in PluginProcessor.cpp
-// and .h and PluginEditor.cpp and .h) we need to use the inline keyword, otherwise compiler
-// will produce a definition for this function each place the header file is included,
-//and the linker will not know which compiled .cpp file to use for the definition
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+using MonoChain = ChainCascade<float>;
+
+// A biquad that vectorises along time instead of across channels, for when there is only one channel
+// to fill the SIMD lanes with. The recursion is rewritten in block state-space form: with the TDF-II
+// state s = (s1, s2), a block of numLanes outputs is
+//      y[k] = (C A^k) s + sum_{j <= k} h[k - j] x[j]
+// and the state after the block is
+//      s' = A^numLanes s + sum_j A^(numLanes - 1 - j) B x[j]
+// All of those matrices are precomputed in double when the coefficients change, so each block is a
+// handful of independent multiply-adds, and only the 2-element state carries a dependency from one
+// block to the next. The results differ from the direct recursion by float rounding only.
+struct TimeParallelBiquad
 {
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq, sampleRate, 2 * (chainSettings.lowCutSlope + 1));
-}
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+    static constexpr size_t blockSize = SIMDFloat::SIMDNumElements;
+    
+    void setCoefficients(const Coefficients& newCoefficients);
+    
+    // state1 and state2 are the section state the same transposed direct form II state BiquadCascade keeps
+    void process(float* data, size_t numSamples, float& state1, float& state2) const noexcept;
+    
+private:
+    Coefficients coefficients;
+    
+    // Lane k of stateToOutput[i] is the weight of state element i in output k
+    std::array<SIMDFloat, 2> stateToOutput;
+    // Lane k of inputToOutput[j] is h[k - j], the impulse response, or 0 where k < j
+    std::array<SIMDFloat, blockSize> inputToOutput;
+    // Lanes 0 and 1 hold the next (s1, s2); the other lanes are 0
+    std::array<SIMDFloat, 2> stateToState;
+    std::array<SIMDFloat, blockSize> inputToState;
+};
 
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+// The full chain for every channel of the bus.
+// Channels are split into groups of numLanes (4 with SSE/NEON) and each channel of a group sits in
+// its own lane of a juce::dsp::SIMDRegister, so one vectorised pass over an interleaved copy of the
+// group filters all of its channels together. The filter state is stored structure-of-arrays:
+// per group, per section, one register holding that section's state for every channel in the group.
+// Coefficients are identical across lanes, and the arithmetic is done in the same order as the
+// scalar cascade, so each lane's output matches it exactly unless the compiler contracts the
+// multiply-adds into FMAs (then they differ by a few ULPs, well under 1e-6 relative).
+// Blocks are worked through in tiles of tileSize samples, each one interleaved, carried through the
+// whole cascade and written back before the next, so big offline blocks don't stream the scratch
+// buffer through memory once per pass.
+struct SIMDChain
 {
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq, sampleRate, 2 * (chainSettings.highCutSlope + 1));
-}
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+    static constexpr size_t numLanes = SIMDFloat::SIMDNumElements;
+    static constexpr int maxChannels = 12; // 7.1.4
+    
+    // 256 samples x 4 lanes x 4 bytes is 4 KiB of scratch, which sits comfortably in L1 next to the
+    // channel data being read and written
+    static constexpr size_t defaultTileSize = 256;
+    
+    // Takes effect on the next prepare()
+    void setTileSize(size_t numSamples) { tileSize = juce::jmax(numSamples, (size_t)1); }
+    size_t getTileSize() const { return tileSize; }
+    
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+    
+    void setLowCut(const CutCoefficients& coefficients, Slope slope, bool bypassed);
+    void setPeak(const Coefficients& coefficients, bool bypassed);
+    void setHighCut(const CutCoefficients& coefficients, Slope slope, bool bypassed);
+    
+    void process(const juce::dsp::AudioBlock<float>& block) noexcept;
+    
+    // No section is active, so process() would leave the audio untouched
+    bool isIdentity() const { return cascade.getNumActiveSections() == 0; }
+    int getActiveSections() const { return cascade.getActiveSectionMask(); }
+    
+    // Copies the coefficients and filter state (not the scratch) of a chain prepared with the same
+    // spec, so nothing is allocated
+    void copyFiltersFrom(const SIMDChain& other);
+    
+private:
+    using Cascade = ChainCascade<SIMDFloat>;
+    
+    void resetSections(int sectionMask);
+    
+   #if SIMPLEEQ_TIME_PARALLEL_IIR
+    // Rebuilds the block matrices of the active sections in sectionMask, if any group needs them
+    void updateTimeParallelSections(int sectionMask);
+    void processSingleChannel(float* data, size_t numSamples, Cascade::State& state) noexcept;
+    
+    std::array<TimeParallelBiquad, Cascade::numSections> timeParallelSections;
+    // Set in prepare() when the last group holds a single channel, the only case that uses them
+    bool hasSingleChannelGroup = false;
+   #endif
+    
+    Cascade cascade;
+    std::vector<Cascade::State> groups;
+    std::vector<SIMDFloat> interleaved;
+    size_t tileSize = defaultTileSize;
+};
+
+// One complete set of coefficients for the chain, plus the settings it was designed from
+struct ChainCoefficients
+{
+    Coefficients peak;
+    CutCoefficients lowCut, highCut;
+    ChainSettings settings;
+};
+
+// A parameter change as the audio thread plays it back: the whole 20 ms ramp towards the new
+// targets, designed ahead of time with one coefficient set per control interval. Step k is in
+// force from startSample + k * interval on the audio thread's sample clock, and the last step,
+// which holds the targets themselves, stays in force once the ramp has run out
+struct CoefficientRamp
+{
+    juce::uint64 startSample = 0;
+    int interval = 32;
+    int numSteps = 1;
+    // Bands that change anywhere in the ramp, one bit per ChainPositions entry
+    int bands = 0;
+    // Sized once in prepare(), so publishing never allocates
+    std::vector<ChainCoefficients> steps;
+};
+
+// Turns parameter changes into coefficient updates at a fixed control rate, without designing
+// anything on the audio thread.
+// A background thread listens to the parameters and, whenever one changes, designs the ramp from
+// wherever the audio thread has got to towards the new targets: the frequency, gain and Q go
+// through 20 ms smoothers stepped once per control interval, and every band that moves is
+// designed at every step. The ramp is handed over through a TripleBuffer. processBlock is cut
+// into sub-blocks and advance() is called at the start of each one; all it does is look up the
+// step for the current sample position, so the audio thread only ever loads coefficients and
+// large buffers still don't zipper.
+// Each band has a version counter bumped by its own parameters, so only the bands that changed
+// are read, and only the moving ones are designed.
+struct ControlRateScheduler : juce::Thread,
+juce::AudioProcessorValueTreeState::Listener
+{
+    ControlRateScheduler(juce::AudioProcessorValueTreeState& apvts, const ParameterHandles& params);
+    ~ControlRateScheduler() override;
+    
+    // Called while audio is stopped: jumps straight to the current parameter values, designs every
+    // band synchronously and starts the thread
+    void prepare(double sampleRate);
+    void release();
+    
+    // Marks every band as changed, e.g. after a new state has been loaded. Safe from any thread
+    void triggerUpdate();
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    
+    // Audio thread. Picks up a newly published ramp and moves to the step for the current sample
+    // position. Returns the bands whose coefficients changed, one bit per ChainPositions entry
+    int advance();
+    
+    // Audio thread. Moves the sample clock on once a sub-block has been processed
+    void samplesProcessed(int numSamples);
+    
+    // Audio thread. False when advance() would have nothing to do until a new ramp is published
+    bool isRamping() const { return currentStep < ramps.getReadBuffer().numSteps - 1; }
+    
+    // Audio thread. The coefficients of the current step
+    const ChainCoefficients& getCoefficients() const { return ramps.getReadBuffer().steps[(size_t)currentStep]; }
+    
+    // Sub-block length in samples for each "Control Rate" choice
+    static int getControlInterval(int controlRateIndex);
+    
+    void run() override;
+    
+private:
+    void requestRamp();
+    void publishRamp();
+    void readTargets(ChainPositions band);
+    void designBand(ChainPositions band);
+    
+    juce::AudioProcessorValueTreeState& apvts;
+    const ParameterHandles& params;
+    TripleBuffer<CoefficientRamp> ramps;
+    
+    // Bumped by the parameter listeners, one per ChainPositions entry
+    std::array<std::atomic<juce::uint32>, 3> bandVersions {};
+    std::atomic<bool> needsUpdate { false };
+    
+    // Samples the audio thread has processed since prepare(). Read by the designer to place new ramps
+    std::atomic<juce::uint64> playedSamples { 0 };
+    
+    // Audio thread only
+    juce::uint64 position = 0;
+    int currentStep = 0;
+    
+    // Designer thread only (and prepare()). The smoothers hold their state at rampStart, the start
+    // of the last ramp published
+    std::array<juce::uint32, 3> seenBandVersions {};
+    
+    // Frequencies and Q ramp multiplicatively so a sweep sounds even across the range
+    using Multiplicative = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+    Multiplicative lowCutFreq, highCutFreq, peakFreq, peakQuality;
+    juce::SmoothedValue<float> peakGain;
+    juce::uint64 rampStart = 0;
+    
+    // Settings and coefficients at the end of the last ramp published
+    ChainCoefficients latest;
+    double sampleRate = 44100.0;
+};
+
+// Times processBlock against its realtime budget (numSamples / sampleRate), so the load can be
+// watched in a host we can't attach a profiler to. The audio thread is the only writer and never
+// waits: each block is counted into a histogram of atomics and its time is split between the
+// stages below. Blocks over spikeThreshold of their budget, or slower than any before them, also
+// go into a short ring. Each ring slot carries a sequence number so a reader can detect a slot
+// that changed while it was being copied and try again.
+struct LoadMeter
+{
+    enum Stage
+    {
+        Stage_Parameters,   // picking up new ramps and stepping through them
+        Stage_Coefficients, // loading new coefficients into the chain
+        Stage_DSP,
+        Stage_Analyzer,     // copying into the analyzer tap
+        
+        Stage_NumStages
+    };
+    
+    static const char* getStageName(Stage stage);
+    
+    // 5% of the budget per bin, the last one holds everything from 200% up
+    static constexpr int numBins = 41;
+    static constexpr float binWidth = 0.05f;
+    static constexpr int numWorstBlocks = 16;
+    static constexpr float spikeThreshold = 0.5f;
+    
+    // Lives on the audio thread's stack for one block
+    struct BlockTimer
+    {
+        // Charges the time since the previous lap, or since the block started, to stage
+        void lap(Stage stage) noexcept
+        {
+            auto now = juce::Time::getHighResolutionTicks();
+            ticks[stage] += now - last;
+            last = now;
+        }
+        
+        juce::int64 last = 0;
+        std::array<juce::int64, Stage_NumStages> ticks {};
+    };
+    
+    struct WorstBlock
+    {
+        juce::uint64 blockIndex = 0;
+        int numSamples = 0;
+        // Fractions of the block's budget
+        float load = 0;
+        std::array<float, Stage_NumStages> stageLoads {};
+    };
+    
+    struct Snapshot
+    {
+        double sampleRate = 0;
+        juce::uint64 numBlocks = 0;
+        std::array<juce::uint32, numBins> histogram {};
+        // Totals over every block, in seconds
+        double budgetSeconds = 0;
+        std::array<double, Stage_NumStages> stageSeconds {};
+        float worstLoad = 0;
+        // Oldest first
+        std::vector<WorstBlock> worstBlocks;
+        
+        // Upper edge of the histogram bin holding the given fraction of blocks
+        float getPercentile(float fraction) const;
+        juce::String toString() const;
+        bool writeToFile(const juce::File& file) const { return file.replaceWithText(toString()); }
+    };
+    
+    // Called while audio is stopped. Clears everything
+    void prepare(double sampleRate);
+    
+    BlockTimer startBlock() const noexcept
+    {
+        BlockTimer timer;
+        timer.last = juce::Time::getHighResolutionTicks();
+        return timer;
+    }
+    
+    void endBlock(const BlockTimer& timer, int numSamples) noexcept;
+    
+    // Message thread. The last block's load, and the worst one since the previous call
+    float getLoad() const { return lastLoad.load(std::memory_order_relaxed); }
+    float takePeakLoad() { return peakLoad.exchange(0.f, std::memory_order_relaxed); }
+    
+    Snapshot getSnapshot() const;
+
+private:
+    struct WorstBlockSlot
+    {
+        // Odd while the audio thread is writing the slot
+        std::atomic<juce::uint32> sequence { 0 };
+        std::atomic<juce::uint64> blockIndex { 0 };
+        std::atomic<int> numSamples { 0 };
+        std::atomic<float> load { 0.f };
+        std::array<std::atomic<float>, Stage_NumStages> stageLoads {};
+    };
+    
+    Snapshot readSnapshot() const;
+    
+    // Only ever written by the audio thread, so a relaxed load and store do instead of a locked add
+    template<typename T>
+    static void add(std::atomic<T>& counter, T amount) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    
+    // Odd while prepare() is clearing everything, and bumped again once it's done
+    std::atomic<juce::uint32> generation { 0 };
+    
+    // Read by getSnapshot() on the message thread
+    std::atomic<double> sampleRate { 44100.0 };
+    double secondsPerTick = 0;
+    
+    std::atomic<juce::uint64> numBlocks { 0 };
+    std::array<std::atomic<juce::uint32>, numBins> histogram {};
+    std::atomic<double> budgetSeconds { 0 };
+    std::array<std::atomic<double>, Stage_NumStages> stageSeconds {};
+    
+    std::atomic<float> lastLoad { 0.f }, peakLoad { 0.f }, worstLoad { 0.f };
+    
+    std::array<WorstBlockSlot, numWorstBlocks> worstBlocks;
+    std::atomic<juce::uint64> numWorstBlocksWritten { 0 };
+};
 
 //==============================================================================
 /**
@@ -265,17 +912,31 @@ public:
     // static because we don't use any member variables
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
+    const ParameterHandles parameterHandles { apvts };
+    
+    StereoCaptureRing analyzerTap;
     
-    using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleFifo<BlockType> leftChannelFifo { Channel::Left };
-    SingleChannelSampleFifo<BlockType> rightChannelFifo { Channel::Right };
+    LoadMeter loadMeter;
 
 private:
-    MonoChain leftChain, rightChain;
-    void updatePeakFilter(const ChainSettings& chainSettings);
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
-    void updateFilters();
+    SIMDChain chain;
+    
+    // When a band switches in or out of the chain, the chain as it was keeps running here and is
+    // crossfaded into the new one, so enabling a band never clicks
+    SIMDChain fadingChain;
+    juce::AudioBuffer<float> crossfadeBuffer;
+    int crossfadeLength = 0, crossfadeSamplesRemaining = 0;
+    // Bands with new coefficients held back until the running crossfade is over
+    int pendingBands = 0;
+    void processCrossfade(const juce::dsp::AudioBlock<float>& block);
+    
+    void updatePeakFilter(const ChainCoefficients& chainCoefficients);
+    void updateLowCutFilters(const ChainCoefficients& chainCoefficients);
+    void updateHighCutFilters(const ChainCoefficients& chainCoefficients);
+    void updateFilters(const ChainCoefficients& chainCoefficients, int changedBands);
+    ChainSettings appliedSettings;
+    
+    ControlRateScheduler controlRateScheduler { apvts, parameterHandles };
     
     juce::dsp::Oscillator<float> osc;
     //==============================================================================
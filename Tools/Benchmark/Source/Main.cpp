@@ -0,0 +1,743 @@
+/*
+  ==============================================================================
+
+    processBlock benchmark: times SimpleEQAudioProcessor over a matrix of
+    block sizes, sample rates, slopes, bypass states and analyzer on/off,
+    and writes the results as JSON so two runs can be compared.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/PluginEditor.h"
+#include "../../Shared/ToolHelpers.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+
+namespace
+{
+struct BenchmarkOptions
+{
+    // Every combination rather than one axis at a time around the baseline
+    bool fullMatrix = false;
+    // Only check the cut designer against JUCE's, then exit
+    bool checkDesignOnly = false;
+    // Seconds of audio pushed through each case, after the warm-up
+    double seconds = 2.0;
+    int numChannels = 2;
+    juce::File outputFile;
+    juce::File baselineFile;
+    // Slowdown in ns/sample, in percent, that --compare reports as a regression
+    double tolerance = 10.0;
+};
+
+// Which parameters runCase moves before every block, as host automation would
+enum class Automation
+{
+    None,
+    Peak,
+    AllBands
+};
+
+struct BenchmarkCase
+{
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    Slope slope = Slope_48;
+    bool lowCutBypassed = false, peakBypassed = false, highCutBypassed = false;
+    bool analyzerEnabled = false;
+    Automation automation = Automation::None;
+    
+    // Stable across runs, used to match cases up in --compare
+    juce::String getName() const
+    {
+        return juce::String(sampleRate, 0) + "Hz/" + juce::String(blockSize) + "/"
+             + juce::String(12 * (slope + 1)) + "dB/"
+             + (lowCutBypassed ? "-" : "L") + (peakBypassed ? "-" : "P") + (highCutBypassed ? "-" : "H")
+             + (analyzerEnabled ? "/analyzer" : "")
+             + (automation == Automation::Peak ? "/peak-automated" : automation == Automation::AllBands ? "/all-automated" : "");
+    }
+};
+
+struct BlockTimings
+{
+    double nsPerSample = 0;
+    // Per-block wall time in nanoseconds
+    double p50 = 0, p99 = 0, max = 0;
+    int numBlocks = 0;
+};
+
+void printUsage()
+{
+    std::cout << "usage: SimpleEQBenchmark [options]\n"
+                 "  --full                  run every combination instead of one axis at a time\n"
+                 "  --check-design          only compare the cut filter designer with JUCE's and exit\n"
+                 "  --seconds <seconds>     audio per case (default: 2)\n"
+                 "  --channels <count>      bus width (default: 2)\n"
+                 "  --out <file>            write the results as JSON (default: stdout)\n"
+                 "  --compare <file>        report cases slower than a previous run's JSON\n"
+                 "  --tolerance <percent>   slowdown --compare lets through (default: 10)\n";
+}
+
+bool parseArguments(const juce::StringArray& args, BenchmarkOptions& options)
+{
+    auto cwd = juce::File::getCurrentWorkingDirectory();
+    
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const auto& arg = args[i];
+        
+        if (arg == "--full")
+        {
+            options.fullMatrix = true;
+            continue;
+        }
+        
+        if (arg == "--check-design")
+        {
+            options.checkDesignOnly = true;
+            continue;
+        }
+        
+        // Everything else takes a value
+        if (i + 1 >= args.size())
+            return false;
+        
+        const auto& value = args[++i];
+        
+        if (arg == "--seconds")
+            options.seconds = value.getDoubleValue();
+        else if (arg == "--channels")
+            options.numChannels = value.getIntValue();
+        else if (arg == "--out")
+            options.outputFile = cwd.getChildFile(value);
+        else if (arg == "--compare")
+            options.baselineFile = cwd.getChildFile(value);
+        else if (arg == "--tolerance")
+            options.tolerance = value.getDoubleValue();
+        else
+            return false;
+    }
+    
+    return options.seconds > 0 && options.numChannels > 0 && options.numChannels <= SIMDChain::maxChannels;
+}
+
+//==============================================================================
+const std::array<int, 6> blockSizes { 16, 64, 256, 512, 1024, 8192 };
+const std::array<double, 5> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0, 384000.0 };
+const std::array<Slope, 4> slopes { Slope_12, Slope_24, Slope_36, Slope_48 };
+
+std::vector<BenchmarkCase> makeCases(bool fullMatrix)
+{
+    std::vector<BenchmarkCase> cases;
+    
+    if (fullMatrix)
+    {
+        for (auto sampleRate : sampleRates)
+            for (auto blockSize : blockSizes)
+                for (auto slope : slopes)
+                    for (int bypassed = 0; bypassed < 8; ++bypassed)
+                        for (auto analyzer : { false, true })
+                        {
+                            BenchmarkCase c;
+                            c.sampleRate = sampleRate;
+                            c.blockSize = blockSize;
+                            c.slope = slope;
+                            c.lowCutBypassed = (bypassed & 1) != 0;
+                            c.peakBypassed = (bypassed & 2) != 0;
+                            c.highCutBypassed = (bypassed & 4) != 0;
+                            c.analyzerEnabled = analyzer;
+                            cases.push_back(c);
+                        }
+    }
+    else
+    {
+        // One axis at a time, everything else at the baseline: 48 kHz, 512 samples, 48 dB/oct, all bands on
+        const BenchmarkCase baseline;
+        cases.push_back(baseline);
+        
+        for (auto blockSize : blockSizes)
+            if (blockSize != baseline.blockSize) { auto c = baseline; c.blockSize = blockSize; cases.push_back(c); }
+        
+        for (auto sampleRate : sampleRates)
+            if (sampleRate != baseline.sampleRate) { auto c = baseline; c.sampleRate = sampleRate; cases.push_back(c); }
+        
+        for (auto slope : slopes)
+            if (slope != baseline.slope) { auto c = baseline; c.slope = slope; cases.push_back(c); }
+        
+        for (int bypassed = 1; bypassed < 8; ++bypassed)
+        {
+            auto c = baseline;
+            c.lowCutBypassed = (bypassed & 1) != 0;
+            c.peakBypassed = (bypassed & 2) != 0;
+            c.highCutBypassed = (bypassed & 4) != 0;
+            cases.push_back(c);
+        }
+        
+        auto withAnalyzer = baseline;
+        withAnalyzer.analyzerEnabled = true;
+        cases.push_back(withAnalyzer);
+    }
+    
+    // Parameters moving on every block, against the steady baseline above. Design happens on the
+    // scheduler's thread, so what's timed is loading each ramp step into the chain, and with only
+    // the peak moving that should be one band's worth, not the whole chain's
+    for (auto automation : { Automation::Peak, Automation::AllBands })
+    {
+        BenchmarkCase c;
+        c.automation = automation;
+        cases.push_back(c);
+    }
+    
+    return cases;
+}
+
+void setParameter(SimpleEQAudioProcessor& processor, Params param, float value)
+{
+    auto* parameter = processor.apvts.getParameter(getParameterID(param));
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+juce::AudioBuffer<float> makeNoise(int numChannels, int numSamples)
+{
+    juce::AudioBuffer<float> noise (numChannels, numSamples);
+    std::mt19937 generator (1234);
+    std::uniform_real_distribution<float> distribution (-0.5f, 0.5f);
+    
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int i = 0; i < numSamples; ++i)
+            noise.setSample(ch, i, distribution(generator));
+    
+    return noise;
+}
+
+BlockTimings summarise(std::vector<double>& blockNanoseconds, juce::int64 numSamples)
+{
+    BlockTimings timings;
+    
+    if (blockNanoseconds.empty())
+        return timings;
+    
+    std::sort(blockNanoseconds.begin(), blockNanoseconds.end());
+    
+    auto percentile = [&blockNanoseconds](double p)
+    {
+        auto index = (size_t)juce::roundToInt(p * (double)(blockNanoseconds.size() - 1));
+        return blockNanoseconds[index];
+    };
+    
+    double total = 0;
+    for (auto ns : blockNanoseconds)
+        total += ns;
+    
+    timings.nsPerSample = total / (double)numSamples;
+    timings.p50 = percentile(0.5);
+    timings.p99 = percentile(0.99);
+    timings.max = blockNanoseconds.back();
+    timings.numBlocks = (int)blockNanoseconds.size();
+    return timings;
+}
+
+// Runs warmUpBlocks + numBlocks blocks of samplesPerBlock samples and times kernel() on each of
+// the last numBlocks. setUp() runs before every block, outside the timed region
+template<typename SetUp, typename Kernel>
+BlockTimings timeBlocks(int warmUpBlocks, int numBlocks, int samplesPerBlock, SetUp&& setUp, Kernel&& kernel)
+{
+    std::vector<double> blockNanoseconds;
+    blockNanoseconds.reserve((size_t)numBlocks);
+    
+    auto ticksToNanoseconds = 1.0e9 / (double)juce::Time::getHighResolutionTicksPerSecond();
+    
+    for (int block = 0; block < warmUpBlocks + numBlocks; ++block)
+    {
+        setUp();
+        
+        auto start = juce::Time::getHighResolutionTicks();
+        kernel();
+        auto end = juce::Time::getHighResolutionTicks();
+        
+        if (block >= warmUpBlocks)
+            blockNanoseconds.push_back((double)(end - start) * ticksToNanoseconds);
+    }
+    
+    return summarise(blockNanoseconds, (juce::int64)numBlocks * samplesPerBlock);
+}
+
+//==============================================================================
+// Times processBlock one block at a time. The input is refreshed, the analyzer tap drained (as
+// the editor would) and any automated parameters moved between blocks, outside the timed region
+BlockTimings runCase(const BenchmarkCase& benchmarkCase, const BenchmarkOptions& options)
+{
+    SimpleEQAudioProcessor processor;
+    
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add(getChannelSet(options.numChannels));
+    layout.outputBuses.add(getChannelSet(options.numChannels));
+    processor.setBusesLayout(layout);
+    
+    // Bands set so none of them is an identity and skipped
+    setParameter(processor, Param_LowCutFreq, 80.f);
+    setParameter(processor, Param_HighCutFreq, 12000.f);
+    setParameter(processor, Param_PeakFreq, 1000.f);
+    setParameter(processor, Param_PeakGain, 6.f);
+    setParameter(processor, Param_PeakQuality, 1.f);
+    setParameter(processor, Param_LowCutSlope, (float)benchmarkCase.slope);
+    setParameter(processor, Param_HighCutSlope, (float)benchmarkCase.slope);
+    setParameter(processor, Param_LowCutBypassed, benchmarkCase.lowCutBypassed ? 1.f : 0.f);
+    setParameter(processor, Param_PeakBypassed, benchmarkCase.peakBypassed ? 1.f : 0.f);
+    setParameter(processor, Param_HighCutBypassed, benchmarkCase.highCutBypassed ? 1.f : 0.f);
+    setParameter(processor, Param_AnalyzerEnabled, benchmarkCase.analyzerEnabled ? 1.f : 0.f);
+    
+    processor.setRateAndBufferSizeDetails(benchmarkCase.sampleRate, benchmarkCase.blockSize);
+    processor.prepareToPlay(benchmarkCase.sampleRate, benchmarkCase.blockSize);
+    
+    auto noise = makeNoise(options.numChannels, benchmarkCase.blockSize);
+    juce::AudioBuffer<float> buffer (options.numChannels, benchmarkCase.blockSize);
+    juce::MidiBuffer midi;
+    
+    // A quarter of a second to settle caches and branch predictors, never fewer than 16 blocks
+    auto warmUpBlocks = juce::jmax(16, (int)(0.25 * benchmarkCase.sampleRate / benchmarkCase.blockSize));
+    auto numBlocks = juce::jmax(64, (int)(options.seconds * benchmarkCase.sampleRate / benchmarkCase.blockSize));
+    
+    // Automated cases swing between the settings above and nearby ones, so every block has a change
+    bool swung = false;
+    
+    auto automate = [&]
+    {
+        swung = ! swung;
+        
+        if (benchmarkCase.automation == Automation::None)
+            return;
+        
+        setParameter(processor, Param_PeakFreq, swung ? 1100.f : 1000.f);
+        setParameter(processor, Param_PeakGain, swung ? 5.f : 6.f);
+        
+        if (benchmarkCase.automation == Automation::AllBands)
+        {
+            setParameter(processor, Param_LowCutFreq, swung ? 90.f : 80.f);
+            setParameter(processor, Param_HighCutFreq, swung ? 11000.f : 12000.f);
+        }
+    };
+    
+    auto timings = timeBlocks(warmUpBlocks, numBlocks, benchmarkCase.blockSize,
+                              [&]
+                              {
+                                  buffer.makeCopyOf(noise, true);
+                                  processor.analyzerTap.skipToLatest(0);
+                                  automate();
+                              },
+                              [&] { processor.processBlock(buffer, midi); });
+    
+    processor.releaseResources();
+    return timings;
+}
+
+//==============================================================================
+// The chain on its own, for choices made below processBlock: SIMDChain's tile size over a
+// large block, and on a single channel the time-parallel kernel against the fused scalar
+// cascade and the juce::dsp::IIR::Filter chain it replaced. All of them run the same 9 sections
+ChainSettings makeKernelSettings()
+{
+    ChainSettings settings;
+    settings.lowCutFreq = 80.f;
+    settings.highCutFreq = 12000.f;
+    settings.peakFreq = 1000.f;
+    settings.peakGainInDecibels = 6.f;
+    settings.lowCutSlope = Slope_48;
+    settings.highCutSlope = Slope_48;
+    return settings;
+}
+
+BlockTimings runChain(SIMDChain& chain, int numChannels, int blockSize, const BenchmarkOptions& options)
+{
+    const double sampleRate = 48000.0;
+    auto settings = makeKernelSettings();
+    
+    chain.prepare({ sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels });
+    chain.setLowCut(makeLowCutFilter(settings, sampleRate), settings.lowCutSlope, false);
+    chain.setPeak(makePeakFilter(settings, sampleRate), false);
+    chain.setHighCut(makeHighCutFilter(settings, sampleRate), settings.highCutSlope, false);
+    
+    auto noise = makeNoise(numChannels, blockSize);
+    juce::AudioBuffer<float> buffer (numChannels, blockSize);
+    juce::dsp::AudioBlock<float> audioBlock (buffer);
+    auto numBlocks = juce::jmax(64, (int)(options.seconds * sampleRate / blockSize));
+    
+    return timeBlocks(16, numBlocks, blockSize,
+                      [&] { buffer.makeCopyOf(noise, true); },
+                      [&] { chain.process(audioBlock); });
+}
+
+BlockTimings runFusedCascade(int blockSize, const BenchmarkOptions& options)
+{
+    const double sampleRate = 48000.0;
+    auto settings = makeKernelSettings();
+    
+    MonoChain cascade;
+    MonoChain::State state;
+    cascade.setLowCut(makeLowCutFilter(settings, sampleRate), settings.lowCutSlope, false);
+    cascade.setPeak(makePeakFilter(settings, sampleRate), false);
+    cascade.setHighCut(makeHighCutFilter(settings, sampleRate), settings.highCutSlope, false);
+    state.reset();
+    
+    auto noise = makeNoise(1, blockSize);
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    auto numBlocks = juce::jmax(64, (int)(options.seconds * sampleRate / blockSize));
+    
+    return timeBlocks(16, numBlocks, blockSize,
+                      [&] { buffer.makeCopyOf(noise, true); },
+                      [&] { cascade.process(buffer.getWritePointer(0), (size_t)blockSize, state); });
+}
+
+// One juce::dsp::IIR::Filter per section, each run over the whole block in turn
+BlockTimings runJuceFilters(int blockSize, const BenchmarkOptions& options)
+{
+    const double sampleRate = 48000.0;
+    auto settings = makeKernelSettings();
+    
+    std::vector<Coefficients> sections;
+    for (const auto& section : makeLowCutFilter(settings, sampleRate))
+        sections.push_back(section);
+    sections.push_back(makePeakFilter(settings, sampleRate));
+    for (const auto& section : makeHighCutFilter(settings, sampleRate))
+        sections.push_back(section);
+    
+    std::vector<juce::dsp::IIR::Filter<float>> filters (sections.size());
+    
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        const auto& [b0, b1, b2, a1, a2] = sections[i].coefficients;
+        filters[i].coefficients = new juce::dsp::IIR::Coefficients<float>(b0, b1, b2, 1.f, a1, a2);
+        filters[i].prepare({ sampleRate, (juce::uint32)blockSize, 1 });
+    }
+    
+    auto noise = makeNoise(1, blockSize);
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::dsp::AudioBlock<float> audioBlock (buffer);
+    juce::dsp::ProcessContextReplacing<float> context (audioBlock);
+    auto numBlocks = juce::jmax(64, (int)(options.seconds * sampleRate / blockSize));
+    
+    return timeBlocks(16, numBlocks, blockSize,
+                      [&] { buffer.makeCopyOf(noise, true); },
+                      [&]
+                      {
+                          for (auto& filter : filters)
+                              filter.process(context);
+                      });
+}
+
+// The editor's analysis of one side: audio arriving in samplesPerCall chunks, with a new FFT due
+// every hopSize samples. "Blocks" here are calls to PathProducer::process
+BlockTimings runAnalyzer(int hopSize, int samplesPerCall, const BenchmarkOptions& options)
+{
+    const double sampleRate = 48000.0;
+    const juce::Rectangle<float> fftBounds (0.f, 0.f, 560.f, 110.f);
+    
+    PathProducer pathProducer;
+    pathProducer.setHopSize(hopSize);
+    
+    auto noise = makeNoise(2, samplesPerCall);
+    auto numCalls = juce::jmax(64, (int)(options.seconds * sampleRate / samplesPerCall));
+    
+    return timeBlocks(16, numCalls, samplesPerCall,
+                      [] {},
+                      [&] { pathProducer.process(noise.getReadPointer(0), noise.getReadPointer(1), samplesPerCall, fftBounds, sampleRate); });
+}
+
+//==============================================================================
+// designButterworthCut against the juce::dsp::FilterDesign methods it replaced, for every order,
+// both directions, and a grid of cutoffs and sample rates. Both put the sections in the same pole
+// order, so section i is compared with section i, and a missing or extra one fails outright.
+// Returns the largest relative difference of any coefficient. Low-pass numerators at low cutoffs
+// are tiny (b0 is around 3e-9 at 20 Hz and 384 kHz), so an absolute difference would hide them
+const std::array<float, 9> designFrequencies { 20.f, 50.f, 100.f, 250.f, 1000.f, 4000.f, 10000.f, 16000.f, 20000.f };
+// What --check-design lets through. JUCE designs in float, which puts the largest difference over
+// this grid at about 2e-6
+constexpr double designTolerance = 1.0e-5;
+
+double compareCutDesigns()
+{
+    double worst = 0;
+    
+    for (auto sampleRate : sampleRates)
+        for (auto frequency : designFrequencies)
+            for (int order = 2; order <= 8; order += 2)
+                for (auto isHighPass : { false, true })
+                {
+                    CutCoefficients ours;
+                    auto numSections = designButterworthCut(ours, isHighPass, frequency, sampleRate, order);
+                    
+                    auto theirs = isHighPass
+                        ? juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(frequency, sampleRate, order)
+                        : juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(frequency, sampleRate, order);
+                    
+                    if (theirs.size() != numSections)
+                        return std::numeric_limits<double>::infinity();
+                    
+                    for (int i = 0; i < numSections; ++i)
+                    {
+                        const auto* raw = theirs.getObjectPointerUnchecked(i)->getRawCoefficients();
+                        
+                        for (size_t c = 0; c < 5; ++c)
+                        {
+                            auto expected = (double)raw[c];
+                            auto difference = std::abs((double)ours[(size_t)i].coefficients[c] - expected);
+                            
+                            // Only a coefficient that is exactly 0 falls back to the absolute difference
+                            worst = juce::jmax(worst, expected != 0.0 ? difference / std::abs(expected) : difference);
+                        }
+                    }
+                }
+    
+    return worst;
+}
+
+// One 48 dB/oct low cut and high cut design per "block", with the cutoff moving every time
+BlockTimings runDesigner(bool useJuce, const BenchmarkOptions& options)
+{
+    const double sampleRate = 48000.0;
+    auto numDesigns = juce::jmax(1024, (int)(options.seconds * 100000.0));
+    
+    int designIndex = 0;
+    float frequency = 20.f;
+    CutCoefficients lowCut, highCut;
+    juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> juceLowCut, juceHighCut;
+    
+    // Samples here are designs, so nsPerSample is the time per pair of designs
+    return timeBlocks(64, numDesigns, 1,
+                      [&] { frequency = designFrequencies[(size_t)(designIndex++ % (int)designFrequencies.size())]; },
+                      [&]
+                      {
+                          if (useJuce)
+                          {
+                              juceLowCut = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(frequency, sampleRate, 8);
+                              juceHighCut = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(frequency, sampleRate, 8);
+                          }
+                          else
+                          {
+                              designButterworthCut(lowCut, true, frequency, sampleRate, 8);
+                              designButterworthCut(highCut, false, frequency, sampleRate, 8);
+                          }
+                      });
+}
+
+//==============================================================================
+juce::var toVar(const BlockTimings& timings)
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("nsPerSample", timings.nsPerSample);
+    object->setProperty("blockNsP50", timings.p50);
+    object->setProperty("blockNsP99", timings.p99);
+    object->setProperty("blockNsMax", timings.max);
+    object->setProperty("blocks", timings.numBlocks);
+    return juce::var(object);
+}
+
+juce::var toVar(const BenchmarkCase& benchmarkCase, const BlockTimings& timings)
+{
+    auto result = toVar(timings);
+    auto* object = result.getDynamicObject();
+    object->setProperty("name", benchmarkCase.getName());
+    object->setProperty("sampleRate", benchmarkCase.sampleRate);
+    object->setProperty("blockSize", benchmarkCase.blockSize);
+    object->setProperty("slopeDbPerOctave", 12 * (benchmarkCase.slope + 1));
+    object->setProperty("lowCutBypassed", benchmarkCase.lowCutBypassed);
+    object->setProperty("peakBypassed", benchmarkCase.peakBypassed);
+    object->setProperty("highCutBypassed", benchmarkCase.highCutBypassed);
+    object->setProperty("analyzerEnabled", benchmarkCase.analyzerEnabled);
+    object->setProperty("automation", benchmarkCase.automation == Automation::Peak ? "peak"
+                                    : benchmarkCase.automation == Automation::AllBands ? "all" : "none");
+    return result;
+}
+
+juce::var toVar(const juce::String& name, const BlockTimings& timings)
+{
+    auto result = toVar(timings);
+    result.getDynamicObject()->setProperty("name", name);
+    return result;
+}
+
+// Lists every case that got slower than the baseline by more than the tolerance.
+// Returns the number of regressions
+int compareWithBaseline(const juce::var& results, const BenchmarkOptions& options)
+{
+    auto baseline = juce::JSON::parse(options.baselineFile);
+    
+    if (! baseline.isObject())
+    {
+        std::cerr << "Can't read a previous run from " << options.baselineFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    std::map<juce::String, double> baselineTimes;
+    
+    for (auto section : { "cases", "kernels" })
+        if (auto* entries = baseline[section].getArray())
+            for (const auto& entry : *entries)
+                baselineTimes[entry["name"].toString()] = (double)entry["nsPerSample"];
+    
+    int regressions = 0;
+    
+    for (auto section : { "cases", "kernels" })
+        if (auto* entries = results[section].getArray())
+            for (const auto& entry : *entries)
+            {
+                auto found = baselineTimes.find(entry["name"].toString());
+                
+                if (found == baselineTimes.end() || found->second <= 0)
+                    continue;
+                
+                auto change = 100.0 * ((double)entry["nsPerSample"] / found->second - 1.0);
+                
+                if (change > options.tolerance)
+                {
+                    std::cerr << "slower: " << entry["name"].toString() << " " << juce::String(found->second, 3)
+                              << " -> " << juce::String((double)entry["nsPerSample"], 3) << " ns/sample (+"
+                              << juce::String(change, 1) << "%)" << std::endl;
+                    ++regressions;
+                }
+            }
+    
+    return regressions;
+}
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameters need a message manager, even with no UI
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+    
+    BenchmarkOptions options;
+    
+    if (! parseArguments(args, options))
+    {
+        printUsage();
+        return 1;
+    }
+    
+    if (options.checkDesignOnly)
+    {
+        auto designDifference = compareCutDesigns();
+        std::cerr << "cut design vs juce::dsp::FilterDesign, orders 2-8: largest relative difference " << designDifference
+                  << " (tolerance " << designTolerance << ")" << std::endl;
+        
+        return designDifference <= designTolerance ? 0 : 1;
+    }
+    
+    auto* root = new juce::DynamicObject();
+    juce::var results (root);
+    
+    // Enough about the machine and build to tell whether two runs are comparable
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty("juce", juce::SystemStats::getJUCEVersion());
+    root->setProperty("simdLanes", (int)SIMDChain::numLanes);
+    root->setProperty("timeParallelIIR", SIMPLEEQ_TIME_PARALLEL_IIR != 0);
+    root->setProperty("channels", options.numChannels);
+    root->setProperty("secondsPerCase", options.seconds);
+    
+    juce::Array<juce::var> caseResults;
+    
+    for (const auto& benchmarkCase : makeCases(options.fullMatrix))
+    {
+        auto timings = runCase(benchmarkCase, options);
+        caseResults.add(toVar(benchmarkCase, timings));
+        
+        std::cerr << benchmarkCase.getName() << ": " << juce::String(timings.nsPerSample, 3) << " ns/sample, block p50 "
+                  << juce::String(timings.p50 / 1000.0, 2) << " us, p99 " << juce::String(timings.p99 / 1000.0, 2)
+                  << " us, max " << juce::String(timings.max / 1000.0, 2) << " us" << std::endl;
+    }
+    
+    root->setProperty("cases", caseResults);
+    
+    juce::Array<juce::var> kernelResults;
+    
+    for (size_t tileSize : { 64, 128, 256, 512, 1024, 8192 })
+    {
+        SIMDChain chain;
+        chain.setTileSize(tileSize);
+        auto name = "tile/" + juce::String((int)tileSize);
+        auto timings = runChain(chain, juce::jmax(options.numChannels, (int)SIMDChain::numLanes), 8192, options);
+        kernelResults.add(toVar(name, timings));
+        std::cerr << name << ": " << juce::String(timings.nsPerSample, 3) << " ns/sample" << std::endl;
+    }
+    
+    {
+        SIMDChain chain;
+        auto name = juce::String(SIMPLEEQ_TIME_PARALLEL_IIR ? "mono/time-parallel" : "mono/simd-chain");
+        auto timings = runChain(chain, 1, 512, options);
+        kernelResults.add(toVar(name, timings));
+        std::cerr << name << ": " << juce::String(timings.nsPerSample, 3) << " ns/sample" << std::endl;
+        
+        timings = runFusedCascade(512, options);
+        kernelResults.add(toVar("mono/fused-cascade", timings));
+        std::cerr << "mono/fused-cascade: " << juce::String(timings.nsPerSample, 3) << " ns/sample" << std::endl;
+        
+        timings = runJuceFilters(512, options);
+        kernelResults.add(toVar("mono/juce-iir", timings));
+        std::cerr << "mono/juce-iir: " << juce::String(timings.nsPerSample, 3) << " ns/sample" << std::endl;
+    }
+    
+    for (auto useJuce : { false, true })
+    {
+        auto name = juce::String(useJuce ? "design/juce" : "design/closed-form");
+        auto timings = runDesigner(useJuce, options);
+        kernelResults.add(toVar(name, timings));
+        std::cerr << name << ": " << juce::String(timings.nsPerSample, 1) << " ns per low + high cut design" << std::endl;
+    }
+    
+    // The analyzer as it was, with an FFT for every 32-sample host block, against hop sizes with
+    // one call per 60 Hz display frame
+    {
+        const int fftSize = PathProducer().getFFTSize();
+        const int hostBlockSize = 32, samplesPerFrame = 48000 / 60;
+        
+        auto perBlock = runAnalyzer(hostBlockSize, hostBlockSize, options);
+        kernelResults.add(toVar("analyzer/every-block", perBlock));
+        std::cerr << "analyzer/every-block: " << juce::String(perBlock.nsPerSample, 3) << " ns/sample, "
+                  << 48000 / hostBlockSize << " FFTs/s" << std::endl;
+        
+        for (int overlapIndex = 0; overlapIndex < 4; ++overlapIndex)
+        {
+            auto hopSize = PathProducer::getHopSize(fftSize, overlapIndex);
+            auto timings = runAnalyzer(hopSize, samplesPerFrame, options);
+            auto name = "analyzer/hop-" + juce::String(hopSize);
+            auto fftsPerSecond = 48000 / juce::jmax(hopSize, samplesPerFrame);
+            
+            auto result = toVar(name, timings);
+            result.getDynamicObject()->setProperty("fftsPerSecond", fftsPerSecond);
+            result.getDynamicObject()->setProperty("cpuDropPercent", 100.0 * (1.0 - timings.nsPerSample / juce::jmax(perBlock.nsPerSample, 1.0e-9)));
+            kernelResults.add(result);
+            
+            std::cerr << name << ": " << juce::String(timings.nsPerSample, 3) << " ns/sample, " << fftsPerSecond << " FFTs/s, "
+                      << juce::String(100.0 * (1.0 - timings.nsPerSample / juce::jmax(perBlock.nsPerSample, 1.0e-9)), 1)
+                      << "% less than every block" << std::endl;
+        }
+    }
+    
+    root->setProperty("kernels", kernelResults);
+    
+    auto json = juce::JSON::toString(results);
+    
+    if (options.outputFile == juce::File())
+        std::cout << json << std::endl;
+    else if (! options.outputFile.replaceWithText(json))
+    {
+        std::cerr << "Can't write " << options.outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    if (options.baselineFile != juce::File())
+        return compareWithBaseline(results, options) == 0 ? 0 : 1;
+    
+    return 0;
+}
@@ -0,0 +1,416 @@
+/*
+  ==============================================================================
+
+    Parallel batch rendering: a pool of workers, each with its own
+    SimpleEQAudioProcessor, sharing a queue of render jobs.
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include "../../Shared/ToolHelpers.h"
+
+#include <iostream>
+
+bool applyJobSettings(SimpleEQAudioProcessor& processor, const RenderJob& job, juce::String& error)
+{
+    if (job.state.getSize() > 0)
+        processor.setStateInformation(job.state.getData(), (int)job.state.getSize());
+    
+    for (const auto& id : job.parameterValues.getAllKeys())
+    {
+        auto* parameter = processor.apvts.getParameter(id);
+        
+        if (parameter == nullptr)
+        {
+            error = "Unknown parameter \"" + id + "\"";
+            return false;
+        }
+        
+        auto value = job.parameterValues[id].getFloatValue();
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+    
+    return true;
+}
+
+//==============================================================================
+struct BatchRenderer::FileState
+{
+    const RenderJob* job = nullptr;
+    
+    double sampleRate = 0;
+    int numChannels = 0;
+    int bitsPerSample = 0;
+    juce::int64 lengthInSamples = 0;
+    juce::StringPairArray metadata;
+    
+    // Temporary outputs, one per segment; empty when the file is rendered in one piece
+    juce::Array<juce::File> parts;
+    
+    std::atomic<int> segmentsRemaining { 0 };
+    std::atomic<bool> failed { false };
+    std::atomic<double> startTime { 0.0 };
+};
+
+//==============================================================================
+struct BatchRenderer::Worker : juce::Thread
+{
+    Worker(BatchRenderer& ownerToUse, int indexToUse) :
+    juce::Thread("SimpleEQ Render " + juce::String(indexToUse)),
+    owner(ownerToUse),
+    index(indexToUse),
+    buffer(SIMDChain::maxChannels, ownerToUse.settings.blockSize)
+    {
+        formats.registerBasicFormats();
+    }
+    
+    void push(const SegmentTask& task)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        tasks.push_back(task);
+    }
+    
+    // Own work comes off the back, thieves take from the front
+    bool popOwn(SegmentTask& task)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        
+        if (tasks.empty())
+            return false;
+        
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+    
+    bool popForThief(SegmentTask& task)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        
+        if (tasks.empty())
+            return false;
+        
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+    
+    void run() override
+    {
+        // Everything is queued before the workers start, so once there's nothing left to
+        // take or steal, the batch is done as far as this worker is concerned
+        SegmentTask task;
+        
+        while (! threadShouldExit() && (popOwn(task) || owner.steal(index, task)))
+        {
+            if (! task.file->failed && ! renderSegment(task))
+                task.file->failed = true;
+            
+            owner.finishSegment(*task.file, formats);
+        }
+    }
+    
+    bool renderSegment(const SegmentTask& task)
+    {
+        auto& file = *task.file;
+        const auto& job = *file.job;
+        
+        auto now = juce::Time::getMillisecondCounterHiRes();
+        double notStarted = 0.0;
+        file.startTime.compare_exchange_strong(notStarted, now);
+        
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(job.input));
+        
+        if (reader == nullptr)
+            return fail(job.input.getFullPathName() + ": not a readable audio file");
+        
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(getChannelSet(file.numChannels));
+        layout.outputBuses.add(getChannelSet(file.numChannels));
+        
+        if (! processor.setBusesLayout(layout))
+            return fail(job.input.getFullPathName() + ": " + juce::String(file.numChannels) + " channels aren't supported");
+        
+        juce::String error;
+        if (! applyJobSettings(processor, job, error))
+            return fail(error);
+        
+        // A file in one piece goes straight to its output, in the input's format and bit depth.
+        // Segments go to 32-bit float parts so stitching them loses nothing
+        auto renderingParts = ! file.parts.isEmpty();
+        auto output = renderingParts ? file.parts[task.index] : job.output;
+        output.deleteFile();
+        
+        juce::AudioFormat* format = nullptr;
+        auto bitsPerSample = 32;
+        
+        if (renderingParts)
+        {
+            format = formats.findFormatForFileExtension("wav");
+        }
+        else
+        {
+            format = formats.findFormatForFileExtension(job.input.getFileExtension());
+            bitsPerSample = file.bitsPerSample;
+        }
+        
+        std::unique_ptr<juce::FileOutputStream> stream (output.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        
+        if (format != nullptr && stream != nullptr)
+            writer.reset(format->createWriterFor(stream.get(), file.sampleRate, (unsigned int)file.numChannels,
+                                                 bitsPerSample, file.metadata, 0));
+        
+        if (writer == nullptr)
+            return fail(output.getFullPathName() + ": can't create the output file");
+        
+        // The writer owns the stream now
+        stream.release();
+        
+        auto blockSize = owner.settings.blockSize;
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(file.sampleRate, blockSize);
+        processor.prepareToPlay(file.sampleRate, blockSize);
+        
+        // Start early so the filters have settled by the first sample we keep
+        auto warmUpSamples = (juce::int64)(owner.settings.warmUpSeconds * file.sampleRate);
+        auto start = juce::jmax((juce::int64)0, task.start - warmUpSamples);
+        auto end = task.start + task.length;
+        
+        for (auto position = start; position < end; position += blockSize)
+        {
+            auto numSamples = (int)juce::jmin((juce::int64)blockSize, end - position);
+            juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), file.numChannels, numSamples);
+            
+            reader->read(&block, 0, numSamples, position, true, true);
+            processor.processBlock(block, midi);
+            
+            // Only the part of the block inside the segment is kept
+            auto keepFrom = (int)juce::jmax((juce::int64)0, task.start - position);
+            
+            if (keepFrom < numSamples && ! writer->writeFromAudioSampleBuffer(block, keepFrom, numSamples - keepFrom))
+            {
+                processor.releaseResources();
+                return fail(output.getFullPathName() + ": write failed");
+            }
+        }
+        
+        processor.releaseResources();
+        samplesRendered += task.length;
+        return true;
+    }
+    
+    bool fail(const juce::String& message)
+    {
+        owner.log(message, true);
+        return false;
+    }
+    
+    BatchRenderer& owner;
+    const int index;
+    
+    SimpleEQAudioProcessor processor;
+    juce::AudioFormatManager formats;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+    juce::int64 samplesRendered = 0;
+    
+    std::mutex lock;
+    std::deque<SegmentTask> tasks;
+};
+
+//==============================================================================
+BatchRenderer::BatchRenderer(const BatchSettings& settingsToUse) :
+settings(settingsToUse)
+{
+    // Processors are created here, on the message thread, rather than on the workers
+    for (int i = 0; i < juce::jmax(1, settings.numThreads); ++i)
+        workers.add(new Worker(*this, i));
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    for (auto* worker : workers)
+        worker->stopThread(-1);
+}
+
+BatchReport BatchRenderer::render(const juce::OwnedArray<RenderJob>& jobs)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    
+    files.clear();
+    filesRendered = 0;
+    filesFailed = 0;
+    
+    for (auto* worker : workers)
+        worker->samplesRendered = 0;
+    
+    // Plan every file and deal its segments out round-robin
+    int nextWorker = 0;
+    
+    for (auto* job : jobs)
+    {
+        files.push_back(std::make_unique<FileState>());
+        auto& file = *files.back();
+        file.job = job;
+        
+        if (! planFile(*job, file, formats))
+        {
+            ++filesFailed;
+            continue;
+        }
+        
+        auto segmentLength = juce::jmax((juce::int64)settings.blockSize, (juce::int64)(settings.segmentSeconds * file.sampleRate));
+        auto numSegments = (int)juce::jmax((juce::int64)1, (file.lengthInSamples + segmentLength - 1) / segmentLength);
+        
+        if (numSegments > 1)
+        {
+            for (int i = 0; i < numSegments; ++i)
+                file.parts.add(job->output.getSiblingFile(job->output.getFileNameWithoutExtension() + ".part" + juce::String(i) + ".wav"));
+        }
+        
+        file.segmentsRemaining = numSegments;
+        
+        for (int i = 0; i < numSegments; ++i)
+        {
+            SegmentTask task;
+            task.file = &file;
+            task.index = i;
+            task.start = (juce::int64)i * segmentLength;
+            task.length = juce::jmin(segmentLength, file.lengthInSamples - task.start);
+            
+            workers[nextWorker]->push(task);
+            nextWorker = (nextWorker + 1) % workers.size();
+        }
+    }
+    
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    
+    for (auto* worker : workers)
+        worker->startThread();
+    
+    for (auto* worker : workers)
+        worker->waitForThreadToExit(-1);
+    
+    BatchReport report;
+    report.seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    report.filesRendered = filesRendered;
+    report.filesFailed = filesFailed;
+    report.numThreads = workers.size();
+    
+    for (auto* worker : workers)
+        report.samplesRendered += worker->samplesRendered;
+    
+    return report;
+}
+
+bool BatchRenderer::planFile(const RenderJob& job, FileState& file, juce::AudioFormatManager& formats)
+{
+    // Only the header is read here
+    std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(job.input));
+    
+    if (reader == nullptr)
+    {
+        log(job.input.getFullPathName() + ": not a readable audio file", true);
+        return false;
+    }
+    
+    if (job.output == job.input)
+    {
+        log(job.input.getFullPathName() + ": output would overwrite the input, use --out or --suffix", true);
+        return false;
+    }
+    
+    job.output.getParentDirectory().createDirectory();
+    
+    file.sampleRate = reader->sampleRate;
+    file.numChannels = (int)reader->numChannels;
+    file.bitsPerSample = (int)reader->bitsPerSample;
+    file.lengthInSamples = reader->lengthInSamples;
+    file.metadata = reader->metadataValues;
+    
+    return true;
+}
+
+bool BatchRenderer::steal(int thiefIndex, SegmentTask& task)
+{
+    for (int i = 1; i < workers.size(); ++i)
+    {
+        if (workers[(thiefIndex + i) % workers.size()]->popForThief(task))
+            return true;
+    }
+    
+    return false;
+}
+
+void BatchRenderer::finishSegment(FileState& file, juce::AudioFormatManager& formats)
+{
+    // Whoever finishes the last segment of a file completes it
+    if (--file.segmentsRemaining > 0)
+        return;
+    
+    if (! file.failed && ! file.parts.isEmpty() && ! stitchParts(file, formats))
+        file.failed = true;
+    
+    for (const auto& part : file.parts)
+        part.deleteFile();
+    
+    if (file.failed)
+    {
+        ++filesFailed;
+        return;
+    }
+    
+    ++filesRendered;
+    
+    auto seconds = (juce::Time::getMillisecondCounterHiRes() - file.startTime.load()) / 1000.0;
+    auto duration = (double)file.lengthInSamples / file.sampleRate;
+    
+    log(file.job->input.getFileName() + ": " + juce::String(duration, 1) + " s of audio in "
+        + juce::String(seconds, 3) + " s, " + juce::String(duration / juce::jmax(seconds, 1.0e-9), 1) + "x realtime"
+        + (file.parts.size() > 1 ? " (" + juce::String(file.parts.size()) + " segments)" : juce::String()), false);
+}
+
+bool BatchRenderer::stitchParts(FileState& file, juce::AudioFormatManager& formats)
+{
+    const auto& job = *file.job;
+    job.output.deleteFile();
+    
+    auto* format = formats.findFormatForFileExtension(job.input.getFileExtension());
+    std::unique_ptr<juce::FileOutputStream> stream (job.output.createOutputStream());
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    
+    if (format != nullptr && stream != nullptr)
+        writer.reset(format->createWriterFor(stream.get(), file.sampleRate, (unsigned int)file.numChannels,
+                                             file.bitsPerSample, file.metadata, 0));
+    
+    if (writer == nullptr)
+    {
+        log(job.output.getFullPathName() + ": can't create the output file", true);
+        return false;
+    }
+    
+    stream.release();
+    
+    // Copy the parts across in order, a block at a time
+    for (const auto& part : file.parts)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(part));
+        
+        if (reader == nullptr || ! writer->writeFromAudioReader(*reader, 0, -1))
+        {
+            log(job.output.getFullPathName() + ": couldn't stitch " + part.getFileName(), true);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void BatchRenderer::log(const juce::String& message, bool isError)
+{
+    std::lock_guard<std::mutex> guard(logLock);
+    (isError ? std::cerr : std::cout) << message << std::endl;
+}
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    Parallel batch rendering: a pool of workers, each with its own
+    SimpleEQAudioProcessor, sharing a queue of render jobs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+// One input file and the settings to render it with
+struct RenderJob
+{
+    juce::File input, output;
+    // A getStateInformation blob, may be empty
+    juce::MemoryBlock state;
+    // Parameter ID -> value in the parameter's own units, applied after the state
+    juce::StringPairArray parameterValues;
+};
+
+// Loads the job's state, then its parameter values. Fails on an unknown parameter ID
+bool applyJobSettings(SimpleEQAudioProcessor& processor, const RenderJob& job, juce::String& error);
+
+struct BatchSettings
+{
+    int numThreads = juce::SystemStats::getNumCpus();
+    int blockSize = 8192;
+    // Files longer than this are cut into segments rendered independently
+    double segmentSeconds = 30.0;
+    // Each segment starts this far before its first output sample so the filters have settled
+    double warmUpSeconds = 1.0;
+};
+
+struct BatchReport
+{
+    int filesRendered = 0, filesFailed = 0;
+    // Sample frames written, not counting warm-up
+    juce::int64 samplesRendered = 0;
+    double seconds = 0;
+    int numThreads = 0;
+};
+
+// Renders a list of jobs on numThreads workers, one processor instance per worker.
+// Every file is planned up front as one or more segments. A long file's segments are rendered
+// independently, each with a warm-up pre-roll that's processed but not written. They go to
+// temporary parts that the worker finishing the last segment stitches into the output in order.
+// Segments are dealt round-robin into per-worker queues. A worker takes from the back of its own
+// queue and, once that runs dry, steals from the front of the others', so a few long files don't
+// leave cores idle at the end of a batch.
+class BatchRenderer
+{
+public:
+    explicit BatchRenderer(const BatchSettings& settings);
+    ~BatchRenderer();
+    
+    BatchReport render(const juce::OwnedArray<RenderJob>& jobs);
+
+private:
+    struct FileState;
+    struct SegmentTask
+    {
+        FileState* file = nullptr;
+        int index = 0;
+        juce::int64 start = 0, length = 0;
+    };
+    
+    struct Worker;
+    
+    bool planFile(const RenderJob& job, FileState& file, juce::AudioFormatManager& formats);
+    bool steal(int thiefIndex, SegmentTask& task);
+    void finishSegment(FileState& file, juce::AudioFormatManager& formats);
+    bool stitchParts(FileState& file, juce::AudioFormatManager& formats);
+    void log(const juce::String& message, bool isError);
+    
+    BatchSettings settings;
+    juce::OwnedArray<Worker> workers;
+    std::vector<std::unique_ptr<FileState>> files;
+    
+    std::atomic<int> filesRendered { 0 }, filesFailed { 0 };
+    std::mutex logLock;
+};
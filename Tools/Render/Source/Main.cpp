@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    Offline renderer: streams audio files through SimpleEQAudioProcessor
+    without a host, using either a saved state or parameter values given on
+    the command line.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "BatchRenderer.h"
+
+#include <iostream>
+
+namespace
+{
+struct RenderOptions
+{
+    juce::File stateFile;
+    // Parameter ID -> value in the parameter's own units (Hz, dB, choice index, 0/1)
+    juce::StringPairArray parameterValues;
+    juce::File outputDirectory;
+    juce::String suffix { "_eq" };
+    juce::File jobsFile;
+    BatchSettings batch;
+    juce::Array<juce::File> inputs;
+};
+
+void printUsage()
+{
+    std::cout << "usage: SimpleEQRender [options] <input files...>\n"
+                 "  --state <file>          load a state saved by getStateInformation\n"
+                 "  --param \"<id>=<value>\"  set a parameter after the state, e.g. --param \"Peak Gain=6\"\n"
+                 "  --jobs <file>           one input per line, optionally followed by a tab and a state file\n"
+                 "  --out <dir>             write results here (default: next to each input)\n"
+                 "  --suffix <text>         appended to output file names (default: _eq)\n"
+                 "  --block <samples>       processing block size (default: 8192)\n"
+                 "  --threads <count>       worker threads (default: one per core)\n"
+                 "  --segment <seconds>     split longer files into segments rendered in parallel (default: 30)\n"
+                 "  --warmup <seconds>      filter warm-up before each segment (default: 1)\n";
+}
+
+bool parseArguments(const juce::StringArray& args, RenderOptions& options)
+{
+    auto cwd = juce::File::getCurrentWorkingDirectory();
+    
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const auto& arg = args[i];
+        
+        if (! arg.startsWith("--"))
+        {
+            options.inputs.add(cwd.getChildFile(arg));
+            continue;
+        }
+        
+        // Every option takes a value
+        if (i + 1 >= args.size())
+            return false;
+        
+        const auto& value = args[++i];
+        
+        if (arg == "--state")
+            options.stateFile = cwd.getChildFile(value);
+        else if (arg == "--param" && value.contains("="))
+            options.parameterValues.set(value.upToFirstOccurrenceOf("=", false, false).trim(),
+                                        value.fromFirstOccurrenceOf("=", false, false).trim());
+        else if (arg == "--jobs")
+            options.jobsFile = cwd.getChildFile(value);
+        else if (arg == "--out")
+            options.outputDirectory = cwd.getChildFile(value);
+        else if (arg == "--suffix")
+            options.suffix = value;
+        else if (arg == "--block")
+            options.batch.blockSize = value.getIntValue();
+        else if (arg == "--threads")
+            options.batch.numThreads = value.getIntValue();
+        else if (arg == "--segment")
+            options.batch.segmentSeconds = value.getDoubleValue();
+        else if (arg == "--warmup")
+            options.batch.warmUpSeconds = value.getDoubleValue();
+        else
+            return false;
+    }
+    
+    return (! options.inputs.isEmpty() || options.jobsFile != juce::File())
+        && options.batch.blockSize > 0
+        && options.batch.numThreads > 0
+        && options.batch.segmentSeconds > 0
+        && options.batch.warmUpSeconds >= 0;
+}
+
+bool loadState(const juce::File& stateFile, juce::MemoryBlock& state)
+{
+    if (stateFile == juce::File() || stateFile.loadFileAsData(state))
+        return true;
+    
+    std::cerr << "Can't read state file " << stateFile.getFullPathName() << std::endl;
+    return false;
+}
+
+bool addJob(juce::OwnedArray<RenderJob>& jobs, const juce::File& input, const juce::File& stateFile,
+            const RenderOptions& options)
+{
+    auto* job = jobs.add(new RenderJob());
+    job->input = input;
+    job->parameterValues = options.parameterValues;
+    
+    auto outputDirectory = options.outputDirectory == juce::File() ? input.getParentDirectory() : options.outputDirectory;
+    job->output = outputDirectory.getChildFile(input.getFileNameWithoutExtension() + options.suffix + input.getFileExtension());
+    
+    return loadState(stateFile, job->state);
+}
+
+bool makeJobs(const RenderOptions& options, juce::OwnedArray<RenderJob>& jobs)
+{
+    for (const auto& input : options.inputs)
+    {
+        if (! addJob(jobs, input, options.stateFile, options))
+            return false;
+    }
+    
+    if (options.jobsFile == juce::File())
+        return true;
+    
+    if (! options.jobsFile.existsAsFile())
+    {
+        std::cerr << "Can't read job list " << options.jobsFile.getFullPathName() << std::endl;
+        return false;
+    }
+    
+    // Relative paths in the list are relative to the list
+    auto listDirectory = options.jobsFile.getParentDirectory();
+    juce::StringArray lines;
+    options.jobsFile.readLines(lines);
+    
+    for (const auto& line : lines)
+    {
+        if (line.trim().isEmpty())
+            continue;
+        
+        auto input = listDirectory.getChildFile(line.upToFirstOccurrenceOf("\t", false, false).trim());
+        auto stateName = line.fromFirstOccurrenceOf("\t", false, false).trim();
+        auto stateFile = stateName.isEmpty() ? options.stateFile : listDirectory.getChildFile(stateName);
+        
+        if (! addJob(jobs, input, stateFile, options))
+            return false;
+    }
+    
+    return true;
+}
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameters and state need a message manager, even with no UI
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+    
+    RenderOptions options;
+    
+    if (! parseArguments(args, options))
+    {
+        printUsage();
+        return 1;
+    }
+    
+    juce::OwnedArray<RenderJob> jobs;
+    
+    if (! makeJobs(options, jobs))
+        return 1;
+    
+    // Catch a mistyped --param here, once, rather than on every worker
+    if (! jobs.isEmpty())
+    {
+        SimpleEQAudioProcessor processor;
+        juce::String error;
+        
+        if (! applyJobSettings(processor, *jobs.getFirst(), error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+    
+    BatchRenderer renderer (options.batch);
+    auto report = renderer.render(jobs);
+    
+    auto seconds = juce::jmax(report.seconds, 1.0e-9);
+    auto samplesPerSecond = (double)report.samplesRendered / seconds;
+    
+    std::cout << report.filesRendered << " files (" << report.filesFailed << " failed) in "
+              << juce::String(report.seconds, 3) << " s on " << report.numThreads << " threads: "
+              << juce::String(report.filesRendered / seconds, 2) << " files/s, "
+              << juce::String(samplesPerSecond / 1.0e6, 2) << " M samples/s, "
+              << juce::String(samplesPerSecond / 1.0e6 / report.numThreads, 2) << " M samples/s per core" << std::endl;
+    
+    return report.filesFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+
+    Helpers shared by the command line tools.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// The bus layout for a channel count, as a host would offer it
+inline juce::AudioChannelSet getChannelSet(int numChannels)
+{
+    // canonicalChannelSet() has no immersive layouts, it would call 12 channels discrete
+    if (numChannels == 12)
+        return juce::AudioChannelSet::create7point1point4();
+    
+    return juce::AudioChannelSet::canonicalChannelSet(numChannels);
+}